@@ -86,6 +86,40 @@ function(UCG_ADD_TEST)
     endif()
 endfunction(UCG_ADD_TEST)
 
+# Google Benchmark executable. The <name>_bench_run target writes the results
+# to ${OUT_BINARY_DIR}/benchmarks/<name>.json, run_benchmarks runs all of them.
+function(UCG_ADD_BENCHMARK)
+    set(oneValueArgs SRC)
+    set(multiValueArgs LIBS INCLUDE_DIRS)
+    cmake_parse_arguments(UCG_BENCH "" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+    string(REGEX REPLACE "(.*/)([a-zA-Z0-9_ ]+)(\.cpp)" "\\2" bench_name ${UCG_BENCH_SRC})
+
+    add_executable(${bench_name}_bench ${UCG_BENCH_SRC})
+
+    set_target_properties(${bench_name}_bench PROPERTIES ${OUTPUT_DIR})
+
+    target_link_libraries(${bench_name}_bench PUBLIC benchmark::benchmark)
+    target_link_libraries(${bench_name}_bench PUBLIC ${UCG_BENCH_LIBS})
+    target_include_directories(${bench_name}_bench PUBLIC ${UCG_BENCH_INCLUDE_DIRS})
+    target_compile_definitions(${bench_name}_bench PUBLIC NOMINMAX=1)
+
+    set(bench_out_dir ${OUT_BINARY_DIR}/benchmarks)
+    add_custom_target(${bench_name}_bench_run
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${bench_out_dir}
+        COMMAND ${bench_name}_bench
+            --benchmark_out=${bench_out_dir}/${bench_name}.json
+            --benchmark_out_format=json
+        DEPENDS ${bench_name}_bench
+        USES_TERMINAL
+    )
+
+    if(NOT TARGET run_benchmarks)
+        add_custom_target(run_benchmarks)
+    endif()
+    add_dependencies(run_benchmarks ${bench_name}_bench_run)
+endfunction(UCG_ADD_BENCHMARK)
+
 function(UCG_ADD_APP)
     set(options SHARED)
     set(oneValueArgs SRC)
@@ -132,6 +166,8 @@ function(RUZINO_ADD_LIB LIB_NAME)
     # Exclude files under ${SRC_DIR}/test, ${USD_RESOURCE_DIRS}, and ${SKIP_DIRS}
     list(FILTER ${name}_src_headers EXCLUDE REGEX "${folder}/tests/.*")
     list(FILTER ${name}_cpp_sources EXCLUDE REGEX "${folder}/tests/.*")
+    list(FILTER ${name}_src_headers EXCLUDE REGEX "${folder}/benchmarks/.*")
+    list(FILTER ${name}_cpp_sources EXCLUDE REGEX "${folder}/benchmarks/.*")
 
     foreach(resource_dir ${RUZINO_ADD_LIB_USD_RESOURCE_DIRS})
         list(FILTER ${name}_src_headers EXCLUDE REGEX "${resource_dir}/.*")
@@ -293,6 +329,20 @@ function(RUZINO_ADD_LIB LIB_NAME)
         set_target_properties(${test_name}_test PROPERTIES FOLDER "Libraries/${name}/Tests")
     endforeach()
 
+    if(RZNODE_BUILD_BENCHMARKS)
+        file(GLOB bench_sources ${folder}/benchmarks/*.cpp)
+        foreach(source ${bench_sources})
+            UCG_ADD_BENCHMARK(
+                SRC ${source}
+                LIBS
+                ${name}
+                ${RUZINO_ADD_LIB_PUBLIC_LIBS}
+            )
+            string(REGEX REPLACE "(.*/)([a-zA-Z0-9_ ]+)(\.cpp)" "\\2" bench_name ${source})
+            set_target_properties(${bench_name}_bench PROPERTIES FOLDER "Libraries/${name}/Benchmarks")
+        endforeach()
+    endif()
+
     # Ensure the copy target directory exists only if RESOURCE_COPY_TARGET is specified
     if(RUZINO_ADD_LIB_RESOURCE_COPY_TARGET)
         file(MAKE_DIRECTORY ${RUZINO_ADD_LIB_RESOURCE_COPY_TARGET})
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "nodes/core/api.hpp"
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec_eager.hpp"
+#include "nodes/core/node_link.hpp"
+#include "nodes/core/node_tree.hpp"
+
+// Synthetic graphs for the core benchmarks. All of them are built from two
+// node types: "add" (a + b -> result) and "merge", which sums a runtime
+// dynamic input group.
+RUZINO_NAMESPACE_OPEN_SCOPE
+namespace bench {
+
+inline std::shared_ptr<NodeTreeDescriptor> create_benchmark_descriptor()
+{
+    register_cpp_type<int>();
+
+    auto descriptor = std::make_shared<NodeTreeDescriptor>();
+
+    NodeTypeInfo add_node;
+    add_node.id_name = "add";
+    add_node.ui_name = "Add";
+    add_node.ALWAYS_REQUIRED = true;
+    add_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("a");
+        b.add_input<int>("b").default_val(1);
+        b.add_output<int>("result");
+    });
+    add_node.set_execution_function([](ExeParams params) {
+        auto a = params.get_input<int>("a");
+        auto b = params.get_input<int>("b");
+        params.set_output("result", a + b);
+        return true;
+    });
+    descriptor->register_node(add_node);
+
+    NodeTypeInfo merge_node;
+    merge_node.id_name = "merge";
+    merge_node.ui_name = "Merge";
+    merge_node.ALWAYS_REQUIRED = true;
+    merge_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input_group<int>("inputs").set_runtime_dynamic(true);
+        b.add_output<int>("result");
+    });
+    merge_node.set_execution_function([](ExeParams params) {
+        int sum = 0;
+        for (auto value : params.get_input_group<int>("inputs")) {
+            sum += value;
+        }
+        params.set_output("result", sum);
+        return true;
+    });
+    descriptor->register_node(merge_node);
+
+    return descriptor;
+}
+
+// Generators link without refreshing the topology and refresh it once at the
+// end, otherwise building the bigger graphs is quadratic.
+inline NodeLink* link_add(NodeTree* tree, Node* from, Node* to, const char* in)
+{
+    return tree->add_link(
+        from->get_output_socket("result"),
+        to->get_input_socket(in),
+        false,
+        false);
+}
+
+// a -> a -> ... -> a, `length` nodes in total.
+inline std::vector<Node*> build_chain(NodeTree* tree, size_t length)
+{
+    std::vector<Node*> nodes;
+    for (size_t i = 0; i < length; ++i) {
+        nodes.push_back(tree->add_node("add"));
+        if (i > 0)
+            link_add(tree, nodes[i - 1], nodes[i], "a");
+    }
+    tree->ensure_topology_cache();
+    return nodes;
+}
+
+// One source feeding `width` consumers.
+inline std::vector<Node*> build_fan_out(NodeTree* tree, size_t width)
+{
+    std::vector<Node*> nodes{ tree->add_node("add") };
+    for (size_t i = 0; i < width; ++i) {
+        nodes.push_back(tree->add_node("add"));
+        link_add(tree, nodes.front(), nodes.back(), "a");
+    }
+    tree->ensure_topology_cache();
+    return nodes;
+}
+
+// `count` diamonds in sequence: top -> (left, right) -> bottom, where each
+// bottom is the next top.
+inline std::vector<Node*> build_diamonds(NodeTree* tree, size_t count)
+{
+    std::vector<Node*> nodes{ tree->add_node("add") };
+    for (size_t i = 0; i < count; ++i) {
+        auto top = nodes.back();
+        auto left = tree->add_node("add");
+        auto right = tree->add_node("add");
+        auto bottom = tree->add_node("add");
+        link_add(tree, top, left, "a");
+        link_add(tree, top, right, "a");
+        link_add(tree, left, bottom, "a");
+        link_add(tree, right, bottom, "b");
+        nodes.insert(nodes.end(), { left, right, bottom });
+    }
+    tree->ensure_topology_cache();
+    return nodes;
+}
+
+// Every input is linked to a random earlier node with the given probability,
+// so the graph is acyclic by construction. The seed keeps runs comparable.
+inline std::vector<Node*> build_random_dag(
+    NodeTree* tree,
+    size_t count,
+    double link_probability = 0.5,
+    unsigned seed = 42)
+{
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution has_link(link_probability);
+
+    std::vector<Node*> nodes;
+    for (size_t i = 0; i < count; ++i) {
+        auto node = tree->add_node("add");
+        if (i > 0) {
+            std::uniform_int_distribution<size_t> pick(0, i - 1);
+            for (auto input : { "a", "b" }) {
+                if (has_link(rng))
+                    link_add(tree, nodes[pick(rng)], node, input);
+            }
+        }
+        nodes.push_back(node);
+    }
+    tree->ensure_topology_cache();
+    return nodes;
+}
+
+// A chain of `depth + 1` nodes where every node but the first is wrapped into
+// a group, whose nodes but the first are wrapped into a group again, and so
+// on. Returns the outermost group.
+inline NodeGroup* build_nested_groups(NodeTree* tree, size_t depth)
+{
+    build_chain(tree, depth + 1);
+
+    NodeGroup* outermost = nullptr;
+    NodeTree* level = tree;
+    for (size_t i = 0; i < depth; ++i) {
+        std::vector<Node*> inner;
+        for (auto& node : level->nodes) {
+            if (std::string(node->typeinfo->id_name) == "add")
+                inner.push_back(node.get());
+        }
+        inner.erase(inner.begin());
+
+        auto group = level->group_up(inner);
+        if (!outermost)
+            outermost = group;
+        level = group->get_sub_tree();
+    }
+    return outermost;
+}
+
+// One merge node with `size` sockets in its input group, each fed by its own
+// add node. Returns the merge node.
+inline Node* build_socket_group(NodeTree* tree, size_t size)
+{
+    auto merge = tree->add_node("merge");
+    for (size_t i = 0; i < size; ++i) {
+        auto producer = tree->add_node("add");
+        auto identifier = "input_" + std::to_string(i);
+        auto socket = merge->group_add_socket(
+            "inputs",
+            type_name<int>().c_str(),
+            identifier.c_str(),
+            identifier.c_str(),
+            PinKind::Input);
+        tree->add_link(
+            producer->get_output_socket("result"), socket, false, false);
+    }
+    tree->ensure_topology_cache();
+    return merge;
+}
+
+enum class GraphShape {
+    Chain,
+    FanOut,
+    Diamonds,
+    RandomDag,
+    NestedGroups,
+    SocketGroup,
+};
+
+inline const char* graph_shape_name(GraphShape shape)
+{
+    switch (shape) {
+        case GraphShape::Chain: return "chain";
+        case GraphShape::FanOut: return "fan_out";
+        case GraphShape::Diamonds: return "diamonds";
+        case GraphShape::RandomDag: return "random_dag";
+        case GraphShape::NestedGroups: return "nested_groups";
+        case GraphShape::SocketGroup: return "socket_group";
+    }
+    return "unknown";
+}
+
+// `size` is the node count, except for nested groups where it is the depth.
+inline void build_graph(NodeTree* tree, GraphShape shape, size_t size)
+{
+    switch (shape) {
+        case GraphShape::Chain: build_chain(tree, size); break;
+        case GraphShape::FanOut: build_fan_out(tree, size); break;
+        case GraphShape::Diamonds: build_diamonds(tree, size / 3); break;
+        case GraphShape::RandomDag: build_random_dag(tree, size); break;
+        case GraphShape::NestedGroups: build_nested_groups(tree, size); break;
+        case GraphShape::SocketGroup: build_socket_group(tree, size); break;
+    }
+}
+
+inline std::unique_ptr<NodeTreeExecutor> create_eager_executor()
+{
+    NodeTreeExecutorDesc desc;
+    desc.policy = NodeTreeExecutorDesc::Policy::Eager;
+    return create_node_tree_executor(desc);
+}
+
+}  // namespace bench
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,118 @@
+#include <benchmark/benchmark.h>
+
+#include "graph_generators.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace Ruzino;
+using namespace Ruzino::bench;
+
+// Eager executor costs on the synthetic graphs: preparing, running from
+// scratch, re-running with nothing changed, and re-running after an edit at
+// the root.
+
+static void shape_args(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({ "shape", "size" });
+    for (auto shape : { GraphShape::Chain,
+                        GraphShape::FanOut,
+                        GraphShape::Diamonds,
+                        GraphShape::RandomDag,
+                        GraphShape::SocketGroup }) {
+        for (int64_t size : { 16, 128, 1024 }) {
+            b->Args({ static_cast<int64_t>(shape), size });
+        }
+    }
+    for (int64_t depth : { 2, 4, 8 }) {
+        b->Args({ static_cast<int64_t>(GraphShape::NestedGroups), depth });
+    }
+}
+
+struct ExecFixture {
+    explicit ExecFixture(benchmark::State& state)
+        : descriptor(create_benchmark_descriptor()),
+          tree(create_node_tree(descriptor)),
+          executor(create_eager_executor())
+    {
+        auto shape = static_cast<GraphShape>(state.range(0));
+        build_graph(tree.get(), shape, state.range(1));
+        state.SetLabel(graph_shape_name(shape));
+        state.counters["nodes"] = tree->nodes.size();
+    }
+
+    void set_items_processed(benchmark::State& state) const
+    {
+        state.SetItemsProcessed(state.iterations() * tree->nodes.size());
+    }
+
+    std::shared_ptr<NodeTreeDescriptor> descriptor;
+    std::unique_ptr<NodeTree> tree;
+    std::unique_ptr<NodeTreeExecutor> executor;
+};
+
+static void BM_PrepareTree(benchmark::State& state)
+{
+    ExecFixture fixture(state);
+    for (auto _ : state) {
+        fixture.executor->prepare_tree(fixture.tree.get());
+    }
+    fixture.set_items_processed(state);
+}
+BENCHMARK(BM_PrepareTree)->Apply(shape_args);
+
+// A fresh executor every iteration, so no persistent cache can be reused.
+static void BM_ExecuteCold(benchmark::State& state)
+{
+    ExecFixture fixture(state);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto executor = create_eager_executor();
+        executor->prepare_tree(fixture.tree.get());
+        state.ResumeTiming();
+
+        executor->execute_tree(fixture.tree.get());
+
+        state.PauseTiming();
+        executor.reset();
+        state.ResumeTiming();
+    }
+    fixture.set_items_processed(state);
+}
+BENCHMARK(BM_ExecuteCold)->Apply(shape_args);
+
+// The per-frame path of an idle UI: prepare and execute with nothing dirty.
+static void BM_ExecuteWarm(benchmark::State& state)
+{
+    ExecFixture fixture(state);
+    fixture.executor->execute(fixture.tree.get());
+    for (auto _ : state) {
+        fixture.executor->execute(fixture.tree.get());
+    }
+    fixture.set_items_processed(state);
+}
+BENCHMARK(BM_ExecuteWarm)->Apply(shape_args);
+
+// Dirtying the first node invalidates everything reachable from it.
+static void BM_DirtyPropagation(benchmark::State& state)
+{
+    ExecFixture fixture(state);
+    fixture.executor->execute(fixture.tree.get());
+
+    auto root = fixture.tree->nodes.front().get();
+    for (auto _ : state) {
+        fixture.executor->notify_node_dirty(root);
+        fixture.executor->execute(fixture.tree.get());
+    }
+    fixture.set_items_processed(state);
+}
+BENCHMARK(BM_DirtyPropagation)->Apply(shape_args);
+
+int main(int argc, char** argv)
+{
+    spdlog::set_level(spdlog::level::warn);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
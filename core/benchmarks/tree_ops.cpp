@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+
+#include "graph_generators.hpp"
+#include "spdlog/spdlog.h"
+
+using namespace Ruzino;
+using namespace Ruzino::bench;
+
+// Editing and (de)serialization costs of NodeTree on the synthetic graphs.
+
+static void shape_args(benchmark::internal::Benchmark* b)
+{
+    b->ArgNames({ "shape", "size" });
+    for (auto shape : { GraphShape::Chain,
+                        GraphShape::FanOut,
+                        GraphShape::Diamonds,
+                        GraphShape::RandomDag,
+                        GraphShape::SocketGroup }) {
+        for (int64_t size : { 16, 128, 1024 }) {
+            b->Args({ static_cast<int64_t>(shape), size });
+        }
+    }
+    for (int64_t depth : { 2, 4, 8 }) {
+        b->Args({ static_cast<int64_t>(GraphShape::NestedGroups), depth });
+    }
+}
+
+struct ShapeFixture {
+    explicit ShapeFixture(benchmark::State& state)
+        : descriptor(create_benchmark_descriptor()),
+          tree(create_node_tree(descriptor))
+    {
+        auto shape = static_cast<GraphShape>(state.range(0));
+        build_graph(tree.get(), shape, state.range(1));
+        state.SetLabel(graph_shape_name(shape));
+        state.counters["nodes"] = tree->nodes.size();
+        state.counters["links"] = tree->links.size();
+    }
+
+    std::shared_ptr<NodeTreeDescriptor> descriptor;
+    std::unique_ptr<NodeTree> tree;
+};
+
+static void BM_AddDeleteLink(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    auto tree = fixture.tree.get();
+
+    auto from = tree->nodes.front()->get_output_socket("result");
+    auto to = tree->add_node("add")->get_input_socket("a");
+
+    for (auto _ : state) {
+        auto link = tree->add_link(from, to);
+        tree->delete_link(link);
+    }
+}
+BENCHMARK(BM_AddDeleteLink)->Apply(shape_args);
+
+static void BM_DeleteNode(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    auto tree = fixture.tree.get();
+
+    auto from = tree->nodes.front()->get_output_socket("result");
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto node = tree->add_node("add");
+        tree->add_link(from, node->get_input_socket("a"));
+        state.ResumeTiming();
+
+        tree->delete_node(node);
+    }
+}
+BENCHMARK(BM_DeleteNode)->Apply(shape_args);
+
+static void BM_EnsureTopologyCache(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    for (auto _ : state) {
+        fixture.tree->ensure_topology_cache();
+    }
+    state.SetItemsProcessed(state.iterations() * fixture.tree->nodes.size());
+}
+BENCHMARK(BM_EnsureTopologyCache)->Apply(shape_args);
+
+static void BM_Serialize(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        auto serialized = fixture.tree->serialize();
+        bytes = serialized.size();
+        benchmark::DoNotOptimize(serialized);
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_Serialize)->Apply(shape_args);
+
+// Group subtrees are decoded lazily, see BM_DeserializeMaterialized for the
+// full cost.
+static void BM_Deserialize(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    auto serialized = fixture.tree->serialize();
+    for (auto _ : state) {
+        auto tree = create_node_tree(fixture.descriptor);
+        tree->deserialize(serialized);
+        benchmark::DoNotOptimize(tree);
+    }
+    state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK(BM_Deserialize)->Apply(shape_args);
+
+static void BM_DeserializeMaterialized(benchmark::State& state)
+{
+    ShapeFixture fixture(state);
+    auto serialized = fixture.tree->serialize();
+    for (auto _ : state) {
+        auto tree = create_node_tree(fixture.descriptor);
+        tree->deserialize(serialized);
+        tree->materialize_sub_trees();
+        benchmark::DoNotOptimize(tree);
+    }
+    state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+BENCHMARK(BM_DeserializeMaterialized)
+    ->Args({ static_cast<int64_t>(GraphShape::NestedGroups), 4 })
+    ->Args({ static_cast<int64_t>(GraphShape::NestedGroups), 8 });
+
+int main(int argc, char** argv)
+{
+    spdlog::set_level(spdlog::level::warn);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
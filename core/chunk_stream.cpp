@@ -0,0 +1,80 @@
+#include "nodes/core/chunk_stream.hpp"
+
+#include <shared_mutex>
+#include <unordered_map>
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+ChunkChannelBase::ChunkChannelBase(size_t capacity) : capacity_(capacity)
+{
+}
+
+void ChunkChannelBase::close()
+{
+    {
+        std::lock_guard lock(mutex);
+        closed_ = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+}
+
+void ChunkChannelBase::cancel()
+{
+    {
+        std::lock_guard lock(mutex);
+        cancelled_ = true;
+        drop_chunks();
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+}
+
+size_t ChunkChannelBase::capacity() const
+{
+    return capacity_;
+}
+
+struct ChunkStreamRegistry {
+    std::shared_mutex mutex;
+    std::unordered_map<entt::id_type, ChunkChannelAccessor> accessors;
+};
+
+static ChunkStreamRegistry& chunk_stream_registry()
+{
+    static ChunkStreamRegistry registry;
+    return registry;
+}
+
+void register_chunk_stream_type(
+    entt::id_type type,
+    ChunkChannelAccessor accessor)
+{
+    auto& registry = chunk_stream_registry();
+    std::unique_lock lock(registry.mutex);
+    registry.accessors[type] = std::move(accessor);
+}
+
+bool is_chunk_stream_type(entt::id_type type)
+{
+    auto& registry = chunk_stream_registry();
+    std::shared_lock lock(registry.mutex);
+    return registry.accessors.count(type) != 0;
+}
+
+std::shared_ptr<ChunkChannelBase> find_chunk_channel(
+    const entt::meta_any& value)
+{
+    if (!value) {
+        return nullptr;
+    }
+    auto& registry = chunk_stream_registry();
+    std::shared_lock lock(registry.mutex);
+    auto it = registry.accessors.find(value.type().id());
+    if (it == registry.accessors.end()) {
+        return nullptr;
+    }
+    return it->second(value.data());
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
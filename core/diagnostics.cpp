@@ -0,0 +1,269 @@
+#include "nodes/core/diagnostics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <sstream>
+
+#include "entt/meta/resolve.hpp"
+#include "nodes/core/api.hpp"
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "nodes/core/socket.hpp"
+#include "spdlog/spdlog.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+const char* diagnostic_code_name(DiagnosticCode code)
+{
+    switch (code) {
+        case DiagnosticCode::MissingInput: return "missing input";
+        case DiagnosticCode::InputTypeMismatch: return "input type mismatch";
+        case DiagnosticCode::NodeDeleted: return "node deleted";
+        case DiagnosticCode::NodeAlreadyDeleted: return "node already deleted";
+        case DiagnosticCode::NodeFailed: return "node failed";
+    }
+    return "unknown";
+}
+
+// Probing stops after this many slots and reuses the home slot, so a report
+// costs the same however many nodes have reported before.
+static constexpr size_t dedup_probe_limit = 8;
+
+DiagnosticsChannel::DiagnosticsChannel(size_t capacity)
+    : ring(std::max<size_t>(capacity, 1)),
+      dedup(std::bit_ceil(ring.size() * 2))
+{
+}
+
+DiagnosticsChannel::DedupSlot& DiagnosticsChannel::dedup_slot(
+    const NodeTree* tree,
+    uint64_t node)
+{
+    auto mask = dedup.size() - 1;
+    // Node IDs are sequential or pointers, spread them before masking.
+    auto key = node ^ reinterpret_cast<uintptr_t>(tree);
+    auto home = (key * 0x9E3779B97F4A7C15ull >> 32) & mask;
+
+    // A slot is stale once the ring has overwritten the entry it points to.
+    auto is_live = [this](const DedupSlot& slot) {
+        if (!slot.sequence)
+            return false;
+        auto& entry = ring[(slot.sequence - 1) % ring.size()];
+        return entry.sequence == slot.sequence;
+    };
+
+    DedupSlot* reusable = nullptr;
+    for (size_t i = 0; i < dedup_probe_limit && i < dedup.size(); ++i) {
+        auto& slot = dedup[(home + i) & mask];
+        if (slot.sequence && slot.node == node && slot.tree == tree)
+            return slot;
+        if (!reusable && !is_live(slot))
+            reusable = &slot;
+    }
+    return reusable ? *reusable : dedup[home];
+}
+
+Diagnostic* DiagnosticsChannel::find_latest(const NodeTree* tree, uint64_t node)
+{
+    auto& slot = dedup_slot(tree, node);
+    if (!slot.sequence || slot.node != node || slot.tree != tree)
+        return nullptr;
+    auto& entry = ring[(slot.sequence - 1) % ring.size()];
+    if (entry.sequence != slot.sequence)
+        return nullptr;
+    return &entry;
+}
+
+void DiagnosticsChannel::report(
+    DiagnosticCode code,
+    const NodeTree* tree,
+    uint64_t node,
+    uint64_t socket,
+    uint64_t arg0,
+    uint64_t arg1)
+{
+    std::lock_guard lock(mutex);
+
+    auto latest = find_latest(tree, node);
+    if (latest && latest->code == code && latest->socket == socket &&
+        latest->args[0] == arg0 && latest->args[1] == arg1) {
+        latest->repeat++;
+        return;
+    }
+
+    auto sequence = next_sequence++;
+    auto& entry = ring[(sequence - 1) % ring.size()];
+    if (entry.sequence && !entry.logged) {
+        dropped_count++;
+        unlogged_count--;
+    }
+    unlogged_count++;
+
+    entry.sequence = sequence;
+    entry.repeat = 1;
+    entry.logged = false;
+    entry.tree = tree;
+    entry.code = code;
+    entry.level = diagnostic_level(code);
+    entry.node = node;
+    entry.socket = socket;
+    entry.args[0] = arg0;
+    entry.args[1] = arg1;
+
+    auto& slot = dedup_slot(tree, node);
+    slot.tree = tree;
+    slot.node = node;
+    slot.sequence = sequence;
+}
+
+std::vector<Diagnostic> DiagnosticsChannel::snapshot() const
+{
+    std::lock_guard lock(mutex);
+    std::vector<Diagnostic> result;
+    auto first = next_sequence > ring.size() ? next_sequence - ring.size() : 1;
+    for (auto sequence = first; sequence < next_sequence; ++sequence) {
+        auto& entry = ring[(sequence - 1) % ring.size()];
+        if (entry.sequence == sequence)
+            result.push_back(entry);
+    }
+    return result;
+}
+
+static std::string meta_type_name(uint64_t id)
+{
+    auto type = entt::resolve(get_entt_ctx(), static_cast<entt::id_type>(id));
+    if (!type)
+        return "<unknown>";
+    return std::string(type.info().name());
+}
+
+static void write_node(std::ostream& out, uint64_t id, NodeTree* tree)
+{
+    Node* node = tree ? tree->find_node(NodeId(id)) : nullptr;
+    if (node)
+        out << "node '" << node->typeinfo->id_name << "' (" << id << ")";
+    else
+        out << "node " << id;
+}
+
+static void write_socket(std::ostream& out, uint64_t id, NodeTree* tree)
+{
+    NodeSocket* socket = tree ? tree->find_pin(SocketID(id)) : nullptr;
+    if (socket)
+        out << "'" << socket->ui_name << "'";
+    else
+        out << "socket " << id;
+}
+
+std::string DiagnosticsChannel::format(
+    const Diagnostic& diagnostic,
+    NodeTree* tree) const
+{
+    std::ostringstream out;
+    switch (diagnostic.code) {
+        case DiagnosticCode::MissingInput:
+            write_node(out, diagnostic.node, tree);
+            out << " skipped: missing required input ";
+            write_socket(out, diagnostic.socket, tree);
+            if (diagnostic.args[0] > 1)
+                out << " and " << diagnostic.args[0] - 1 << " more";
+            break;
+        case DiagnosticCode::InputTypeMismatch:
+            out << "type mismatch on input ";
+            write_socket(out, diagnostic.socket, tree);
+            out << " of ";
+            write_node(out, diagnostic.node, tree);
+            out << ", from type " << meta_type_name(diagnostic.args[0])
+                << " to type " << meta_type_name(diagnostic.args[1]);
+            break;
+        case DiagnosticCode::NodeDeleted:
+            write_node(out, diagnostic.node, tree);
+            out << " deleted";
+            break;
+        case DiagnosticCode::NodeAlreadyDeleted:
+            write_node(out, diagnostic.node, tree);
+            out << " not found, repeated delete allowed";
+            break;
+        case DiagnosticCode::NodeFailed: {
+            write_node(out, diagnostic.node, tree);
+            out << " failed";
+            Node* node = tree ? tree->find_node(NodeId(diagnostic.node))
+                              : nullptr;
+            if (node && !node->execution_failed.empty())
+                out << ": " << node->execution_failed;
+        } break;
+    }
+    if (diagnostic.repeat > 1)
+        out << " (x" << diagnostic.repeat << ")";
+    return out.str();
+}
+
+static spdlog::level::level_enum log_level(DiagnosticLevel level)
+{
+    switch (level) {
+        case DiagnosticLevel::Debug: return spdlog::level::debug;
+        case DiagnosticLevel::Info: return spdlog::level::info;
+        case DiagnosticLevel::Warning: return spdlog::level::warn;
+        case DiagnosticLevel::Error: return spdlog::level::err;
+    }
+    return spdlog::level::err;
+}
+
+void DiagnosticsChannel::flush_to_log(NodeTree* tree)
+{
+    std::vector<Diagnostic> pending;
+    {
+        std::lock_guard lock(mutex);
+        if (!unlogged_count)
+            return;
+        auto first =
+            next_sequence > ring.size() ? next_sequence - ring.size() : 1;
+        for (auto sequence = first; sequence < next_sequence; ++sequence) {
+            auto& entry = ring[(sequence - 1) % ring.size()];
+            if (entry.sequence != sequence || entry.logged)
+                continue;
+            // Other trees' entries wait for their own executor's flush
+            if (tree && entry.tree && entry.tree != tree)
+                continue;
+            entry.logged = true;
+            unlogged_count--;
+            pending.push_back(entry);
+        }
+    }
+
+    for (auto& diagnostic : pending) {
+        spdlog::log(
+            log_level(diagnostic.level),
+            "[{}] {}",
+            diagnostic_code_name(diagnostic.code),
+            format(diagnostic, tree));
+    }
+}
+
+size_t DiagnosticsChannel::capacity() const
+{
+    return ring.size();
+}
+
+uint64_t DiagnosticsChannel::dropped() const
+{
+    std::lock_guard lock(mutex);
+    return dropped_count;
+}
+
+void DiagnosticsChannel::clear()
+{
+    std::lock_guard lock(mutex);
+    std::fill(ring.begin(), ring.end(), Diagnostic{});
+    std::fill(dedup.begin(), dedup.end(), DedupSlot{});
+    unlogged_count = 0;
+    dropped_count = 0;
+}
+
+DiagnosticsChannel& diagnostics()
+{
+    static DiagnosticsChannel channel;
+    return channel;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
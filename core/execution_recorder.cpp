@@ -0,0 +1,258 @@
+#include "nodes/core/execution_recorder.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include "nodes/core/api.hpp"
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "nodes/core/value_serializer.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+static bool serialize_entry(
+    const entt::meta_any& value,
+    nlohmann::json& entry)
+{
+    nlohmann::json json;
+    if (!serialize_value(value, json)) {
+        return false;
+    }
+    entry["type"] = value.type().id();
+    entry["value"] = std::move(json);
+    return true;
+}
+
+void ExecutionRecorder::record_input(
+    NodeSocket* socket,
+    const entt::meta_any& value)
+{
+    nlohmann::json entry;
+    std::lock_guard lock(mutex_);
+    if (!serialize_entry(value, entry)) {
+        skipped_values_++;
+        return;
+    }
+    entry["socket"] = socket->ID.Get();
+    pending_inputs_.push_back(std::move(entry));
+}
+
+// Changes with the structure and the defaults of the tree and of its decoded
+// subtrees. Pending subtrees cannot have changed.
+static std::pair<uint64_t, uint64_t> tree_revision(NodeTree* tree)
+{
+    std::pair<uint64_t, uint64_t> revision{ tree->structure_version(), 0 };
+    for (auto& socket : tree->sockets) {
+        revision.second = std::max(revision.second, socket->dataField.version);
+    }
+    for (auto& node : tree->nodes) {
+        if (!node->is_node_group())
+            continue;
+        auto group = static_cast<NodeGroup*>(node.get());
+        if (!group->is_sub_tree_materialized())
+            continue;
+        auto sub_revision = tree_revision(group->get_sub_tree());
+        revision.first += sub_revision.first;
+        revision.second = std::max(revision.second, sub_revision.second);
+    }
+    return revision;
+}
+
+void ExecutionRecorder::begin_run(
+    NodeTree* tree,
+    const entt::meta_any& global_payload)
+{
+    auto revision = tree_revision(tree);
+
+    std::lock_guard lock(mutex_);
+    nlohmann::json run;
+    if (tree != recorded_tree_ || revision != recorded_revision_) {
+        run["tree"] = tree->serialize();
+        recorded_tree_ = tree;
+        recorded_revision_ = revision;
+    }
+
+    run["inputs"] = std::move(pending_inputs_);
+    pending_inputs_ = nlohmann::json::array();
+
+    if (global_payload) {
+        nlohmann::json payload;
+        if (serialize_entry(global_payload, payload))
+            run["global_payload"] = std::move(payload);
+        else
+            skipped_values_++;
+    }
+    runs_.push_back(std::move(run));
+    run_start_ = std::chrono::steady_clock::now();
+}
+
+void ExecutionRecorder::end_run(
+    NodeTreeExecutor* executor,
+    const std::vector<Node*>& executed_nodes)
+{
+    auto elapsed = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - run_start_)
+                       .count();
+
+    nlohmann::json outputs = nlohmann::json::array();
+    size_t skipped = 0;
+    for (auto* node : executed_nodes) {
+        for (auto* output : node->get_outputs()) {
+            auto value = executor->get_socket_value(output);
+            if (!value || !*value)
+                continue;
+            nlohmann::json entry;
+            if (!serialize_entry(*value, entry)) {
+                skipped++;
+                continue;
+            }
+            entry["socket"] = output->ID.Get();
+            outputs.push_back(std::move(entry));
+        }
+    }
+
+    std::lock_guard lock(mutex_);
+    auto& run = runs_.back();
+    run["time_ms"] = elapsed;
+    run["outputs"] = std::move(outputs);
+    skipped_values_ += skipped;
+}
+
+nlohmann::json ExecutionRecorder::to_json() const
+{
+    std::lock_guard lock(mutex_);
+    nlohmann::json recording;
+    recording["runs"] = runs_;
+    return recording;
+}
+
+void ExecutionRecorder::save(const std::filesystem::path& path) const
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write recording " + path.string());
+    }
+    auto cbor = nlohmann::json::to_cbor(to_json());
+    out.write(reinterpret_cast<const char*>(cbor.data()), cbor.size());
+}
+
+size_t ExecutionRecorder::run_count() const
+{
+    std::lock_guard lock(mutex_);
+    return runs_.size();
+}
+
+size_t ExecutionRecorder::skipped_value_count() const
+{
+    std::lock_guard lock(mutex_);
+    return skipped_values_;
+}
+
+double ReplayReport::recorded_ms() const
+{
+    double total = 0;
+    for (auto& run : runs) {
+        total += run.recorded_ms;
+    }
+    return total;
+}
+
+double ReplayReport::replayed_ms() const
+{
+    double total = 0;
+    for (auto& run : runs) {
+        total += run.replayed_ms;
+    }
+    return total;
+}
+
+nlohmann::json load_execution_recording(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot read recording " + path.string());
+    }
+    std::vector<uint8_t> cbor(
+        (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return nlohmann::json::from_cbor(cbor);
+}
+
+ReplayReport replay_execution(
+    const nlohmann::json& recording,
+    std::shared_ptr<NodeTreeDescriptor> descriptor,
+    NodeTreeExecutor* executor)
+{
+    ReplayReport report;
+
+    auto tree = create_node_tree(descriptor);
+    // Older recordings hold a single tree for all runs
+    if (recording.contains("tree"))
+        tree->deserialize(recording["tree"].get<std::string>());
+
+    for (auto& run : recording["runs"]) {
+        ReplayRunReport run_report;
+        run_report.recorded_ms = run.value("time_ms", 0.0);
+
+        if (run.contains("tree")) {
+            tree = create_node_tree(descriptor);
+            tree->deserialize(run["tree"].get<std::string>());
+            executor->mark_tree_structure_changed();
+        }
+
+        executor->prepare_tree(tree.get());
+
+        std::vector<std::pair<NodeSocket*, entt::meta_any>> inputs;
+        for (auto& input : run["inputs"]) {
+            auto socket =
+                tree->find_pin(SocketID(input["socket"].get<unsigned>()));
+            entt::meta_any value;
+            if (!socket || !deserialize_value(
+                               input["type"].get<entt::id_type>(),
+                               input["value"],
+                               value)) {
+                spdlog::warn(
+                    "Replay: cannot restore input of socket {}",
+                    input["socket"].get<unsigned>());
+                continue;
+            }
+            inputs.emplace_back(socket, std::move(value));
+        }
+        executor->sync_batch_from_external_storage(inputs);
+
+        if (run.contains("global_payload")) {
+            entt::meta_any payload;
+            if (deserialize_value(
+                    run["global_payload"]["type"].get<entt::id_type>(),
+                    run["global_payload"]["value"],
+                    payload)) {
+                executor->set_global_payload(payload);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        executor->execute_tree(tree.get());
+        run_report.replayed_ms = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - start)
+                                     .count();
+
+        for (auto& output : run["outputs"]) {
+            auto id = output["socket"].get<unsigned>();
+            auto socket = tree->find_pin(SocketID(id));
+            auto value = socket ? executor->get_socket_value(socket) : nullptr;
+
+            nlohmann::json replayed;
+            run_report.compared_outputs++;
+            if (!value || !serialize_value(*value, replayed) ||
+                replayed != output["value"]) {
+                run_report.mismatched_sockets.push_back(id);
+            }
+        }
+        report.runs.push_back(std::move(run_report));
+    }
+    return report;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "api.hpp"
+#include "entt/meta/meta.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+// The synchronization of a stream, shared by all chunk types so executors can
+// close and cancel streams they do not know the chunk type of.
+class NODES_CORE_API ChunkChannelBase {
+   public:
+    // 0 for no bound
+    explicit ChunkChannelBase(size_t capacity);
+    virtual ~ChunkChannelBase() = default;
+
+    // Producer side: no more chunks. The consumer drains what is left.
+    void close();
+    // Consumer side: no more chunks wanted. Pushing fails from now on and
+    // the chunks not taken are dropped.
+    void cancel();
+
+    size_t capacity() const;
+
+   protected:
+    virtual void drop_chunks() = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+    size_t capacity_;
+    bool closed_ = false;
+    bool cancelled_ = false;
+};
+
+namespace detail {
+template<typename T>
+class ChunkChannel : public ChunkChannelBase {
+   public:
+    using ChunkChannelBase::ChunkChannelBase;
+
+    bool push(T chunk)
+    {
+        std::unique_lock lock(mutex);
+        not_full.wait(lock, [this] {
+            return cancelled_ || !capacity_ || chunks.size() < capacity_;
+        });
+        if (cancelled_ || closed_) {
+            return false;
+        }
+        chunks.push_back(std::move(chunk));
+        lock.unlock();
+        not_empty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop()
+    {
+        std::unique_lock lock(mutex);
+        not_empty.wait(lock, [this] {
+            return cancelled_ || closed_ || !chunks.empty();
+        });
+        if (chunks.empty()) {
+            return std::nullopt;
+        }
+        std::optional<T> chunk = std::move(chunks.front());
+        chunks.pop_front();
+        lock.unlock();
+        not_full.notify_one();
+        return chunk;
+    }
+
+   private:
+    void drop_chunks() override
+    {
+        chunks.clear();
+    }
+
+    std::deque<T> chunks;
+};
+}  // namespace detail
+
+/**
+ * class ChunkStream
+ * A socket value for data too large to be held at once: the producer node
+ * pushes chunks that the consumer node pops while the producer runs. At most
+ * `capacity` chunks are buffered; pushing blocks while the buffer is full, so
+ * a chain of streaming nodes runs in constant memory.
+ *
+ * Copies are handles to the same stream. A stream is consumed once, so nodes
+ * producing streams execute again whenever their consumers run.
+ *
+ * The eager executor runs nodes with stream outputs on their own threads,
+ * with the streams already handed to the consumers, see
+ * ExeParams::get_output_stream(). Register the chunk type with
+ * register_chunk_stream<T>() before building the tree.
+ */
+template<typename T>
+class ChunkStream {
+   public:
+    static constexpr size_t default_capacity = 4;
+
+    // 0 for no bound
+    explicit ChunkStream(size_t capacity = default_capacity)
+        : channel_(std::make_shared<detail::ChunkChannel<T>>(capacity))
+    {
+    }
+
+    // False once the consumer cancelled, the producer should stop then.
+    bool push(T chunk) const
+    {
+        return channel_->push(std::move(chunk));
+    }
+
+    // Waits for the next chunk. Empty once the stream is closed and drained.
+    std::optional<T> pop() const
+    {
+        return channel_->pop();
+    }
+
+    void close() const
+    {
+        channel_->close();
+    }
+
+    void cancel() const
+    {
+        channel_->cancel();
+    }
+
+    size_t capacity() const
+    {
+        return channel_->capacity();
+    }
+
+    std::shared_ptr<ChunkChannelBase> channel() const
+    {
+        return channel_;
+    }
+
+    friend bool operator==(const ChunkStream& lhs, const ChunkStream& rhs)
+    {
+        return lhs.channel_ == rhs.channel_;
+    }
+
+   private:
+    std::shared_ptr<detail::ChunkChannel<T>> channel_;
+};
+
+using ChunkChannelAccessor =
+    std::function<std::shared_ptr<ChunkChannelBase>(const void* value)>;
+
+NODES_CORE_API void register_chunk_stream_type(
+    entt::id_type type,
+    ChunkChannelAccessor accessor);
+
+NODES_CORE_API bool is_chunk_stream_type(entt::id_type type);
+
+// Null when the value is not a registered stream.
+NODES_CORE_API std::shared_ptr<ChunkChannelBase> find_chunk_channel(
+    const entt::meta_any& value);
+
+template<typename T>
+void register_chunk_stream()
+{
+    register_cpp_type<ChunkStream<T>>();
+    register_chunk_stream_type(
+        entt::type_hash<ChunkStream<T>>().value(), [](const void* value) {
+            return static_cast<const ChunkStream<T>*>(value)->channel();
+        });
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -54,6 +54,31 @@
     {                                             \
         return true;                              \
     }
+
+#define NODE_DECLARATION_PURE(name)       \
+    RUZINO_EXPORT bool node_pure_##name() \
+    {                                     \
+        return true;                      \
+    }
+
+#define NODE_DECLARATION_THREAD_SAFE(name)       \
+    RUZINO_EXPORT bool node_thread_safe_##name() \
+    {                                            \
+        return true;                             \
+    }
+
+#define NODE_DECLARATION_COST(name, cost)  \
+    RUZINO_EXPORT float node_cost_##name() \
+    {                                      \
+        return cost;                       \
+    }
+
+// `inputs` lists input identifiers separated by commas, e.g. "mesh,points"
+#define NODE_DECLARATION_INPLACE(name, inputs)      \
+    RUZINO_EXPORT const char* node_inplace_##name() \
+    {                                               \
+        return inputs;                              \
+    }
 #else  // CGHW_STUDENT_NAME is defined!
 
 #define PASTE_HELPER(a, b) a##b
@@ -104,4 +129,30 @@
         return true;                                                           \
     }
 
+#define NODE_DECLARATION_PURE(name)                                    \
+    RUZINO_EXPORT bool PASTE(node_pure_##name##_, CGHW_STUDENT_NAME)() \
+    {                                                                  \
+        return true;                                                   \
+    }
+
+#define NODE_DECLARATION_THREAD_SAFE(name)                                    \
+    RUZINO_EXPORT bool PASTE(node_thread_safe_##name##_, CGHW_STUDENT_NAME)() \
+    {                                                                         \
+        return true;                                                          \
+    }
+
+#define NODE_DECLARATION_COST(name, cost)                               \
+    RUZINO_EXPORT float PASTE(node_cost_##name##_, CGHW_STUDENT_NAME)() \
+    {                                                                   \
+        return cost;                                                    \
+    }
+
+// `inputs` lists input identifiers separated by commas, e.g. "mesh,points"
+#define NODE_DECLARATION_INPLACE(name, inputs)       \
+    RUZINO_EXPORT const char* PASTE(                 \
+        node_inplace_##name##_, CGHW_STUDENT_NAME)() \
+    {                                                \
+        return inputs;                               \
+    }
+
 #endif
\ No newline at end of file
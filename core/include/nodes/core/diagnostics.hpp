@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nodes/core/api.h"
+
+// Diagnostics raised on the executor and tree editing hot paths. Reporting
+// writes a fixed-size record into a preallocated ring and never allocates or
+// logs; the text is only built when someone reads the channel.
+//
+// The minimum level compiled in is chosen with RUZINO_DIAGNOSTICS_MIN_LEVEL,
+// 0 (debug) to 3 (error). Reports below it compile to nothing.
+#ifndef RUZINO_DIAGNOSTICS_MIN_LEVEL
+#define RUZINO_DIAGNOSTICS_MIN_LEVEL 1
+#endif
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+class NodeTree;
+
+enum class DiagnosticLevel : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+};
+
+enum class DiagnosticCode : uint16_t {
+    // socket: the first missing input, args[0]: how many are missing.
+    MissingInput,
+    // socket: the input, args[0] / args[1]: meta type ids of the forwarded
+    // and the expected value.
+    InputTypeMismatch,
+    NodeDeleted,
+    NodeAlreadyDeleted,
+    // The reason is the node's execution_failed.
+    NodeFailed,
+};
+
+constexpr DiagnosticLevel diagnostic_level(DiagnosticCode code)
+{
+    switch (code) {
+        case DiagnosticCode::MissingInput: return DiagnosticLevel::Warning;
+        case DiagnosticCode::InputTypeMismatch: return DiagnosticLevel::Error;
+        case DiagnosticCode::NodeDeleted: return DiagnosticLevel::Debug;
+        case DiagnosticCode::NodeAlreadyDeleted:
+            return DiagnosticLevel::Warning;
+        case DiagnosticCode::NodeFailed: return DiagnosticLevel::Error;
+    }
+    return DiagnosticLevel::Error;
+}
+
+NODES_CORE_API const char* diagnostic_code_name(DiagnosticCode code);
+
+struct Diagnostic {
+    // Order of the first report; identical reports after it only count up
+    // `repeat`.
+    uint64_t sequence = 0;
+    uint32_t repeat = 0;
+    bool logged = false;
+    DiagnosticCode code = DiagnosticCode::MissingInput;
+    DiagnosticLevel level = DiagnosticLevel::Debug;
+    // The tree the node and socket IDs belong to, only compared, never
+    // dereferenced. Null when unknown.
+    const NodeTree* tree = nullptr;
+    uint64_t node = 0;
+    uint64_t socket = 0;
+    uint64_t args[2] = {};
+};
+
+class NODES_CORE_API DiagnosticsChannel {
+   public:
+    explicit DiagnosticsChannel(size_t capacity = 256);
+
+    // A report identical to the latest one of the same node only bumps its
+    // repeat count, so a node failing the same way every run takes one slot.
+    void report(
+        DiagnosticCode code,
+        const NodeTree* tree,
+        uint64_t node,
+        uint64_t socket = 0,
+        uint64_t arg0 = 0,
+        uint64_t arg1 = 0);
+
+    // Oldest first.
+    std::vector<Diagnostic> snapshot() const;
+    // Node and socket names are resolved when the tree still has them.
+    std::string format(const Diagnostic& diagnostic, NodeTree* tree = nullptr)
+        const;
+    // Sends the entries of `tree` reported since they were last flushed to
+    // spdlog, along with those of no tree; all of them for a null tree.
+    // Repeats of an entry already flushed are not logged again.
+    void flush_to_log(NodeTree* tree = nullptr);
+
+    size_t capacity() const;
+    // Entries overwritten before they could be read.
+    uint64_t dropped() const;
+    void clear();
+
+   private:
+    struct DedupSlot {
+        const NodeTree* tree = nullptr;
+        uint64_t node = 0;
+        uint64_t sequence = 0;
+    };
+
+    Diagnostic* find_latest(const NodeTree* tree, uint64_t node);
+    DedupSlot& dedup_slot(const NodeTree* tree, uint64_t node);
+
+    mutable std::mutex mutex;
+    std::vector<Diagnostic> ring;
+    std::vector<DedupSlot> dedup;
+    uint64_t next_sequence = 1;
+    // Entries in the ring not logged yet
+    size_t unlogged_count = 0;
+    uint64_t dropped_count = 0;
+};
+
+// The channel shared by all trees and executors of the process.
+NODES_CORE_API DiagnosticsChannel& diagnostics();
+
+template<DiagnosticCode code>
+constexpr bool diagnostic_enabled =
+    static_cast<int>(diagnostic_level(code)) >= RUZINO_DIAGNOSTICS_MIN_LEVEL;
+
+template<DiagnosticCode code>
+inline void diagnose(
+    const NodeTree* tree,
+    uint64_t node,
+    uint64_t socket = 0,
+    uint64_t arg0 = 0,
+    uint64_t arg1 = 0)
+{
+    if constexpr (diagnostic_enabled<code>) {
+        diagnostics().report(code, tree, node, socket, arg0, arg1);
+    }
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "entt/meta/meta.hpp"
+#include "io/json.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+class NodeTree;
+class NodeTreeDescriptor;
+struct Node;
+struct NodeTreeExecutor;
+struct NodeSocket;
+
+/**
+ * class ExecutionRecorder
+ * Captures a workload so it can be replayed later: the tree, every value set
+ * through sync_node_from_external_storage, the global payload and the outputs
+ * of the nodes each run executed. The tree is stored again with every run
+ * whose structure or defaults changed since the last stored one. Values go
+ * through the value serializer registry; values of unregistered types are
+ * counted but not stored.
+ *
+ * Attach it with NodeTreeExecutor::set_recorder().
+ */
+class NODES_CORE_API ExecutionRecorder {
+   public:
+    void record_input(NodeSocket* socket, const entt::meta_any& value);
+
+    // Called by the executor around execute_tree().
+    void begin_run(NodeTree* tree, const entt::meta_any& global_payload);
+    void end_run(
+        NodeTreeExecutor* executor,
+        const std::vector<Node*>& executed_nodes);
+
+    nlohmann::json to_json() const;
+    void save(const std::filesystem::path& path) const;
+
+    size_t run_count() const;
+    size_t skipped_value_count() const;
+
+   private:
+    mutable std::mutex mutex_;
+    NodeTree* recorded_tree_ = nullptr;
+    std::pair<uint64_t, uint64_t> recorded_revision_;
+    nlohmann::json runs_ = nlohmann::json::array();
+    nlohmann::json pending_inputs_ = nlohmann::json::array();
+    std::chrono::steady_clock::time_point run_start_;
+    size_t skipped_values_ = 0;
+};
+
+struct ReplayRunReport {
+    double recorded_ms = 0;
+    double replayed_ms = 0;
+    size_t compared_outputs = 0;
+    // Socket IDs whose replayed output differs from the recording
+    std::vector<unsigned> mismatched_sockets;
+};
+
+struct ReplayReport {
+    std::vector<ReplayRunReport> runs;
+
+    bool outputs_match() const
+    {
+        for (auto& run : runs) {
+            if (!run.mismatched_sockets.empty())
+                return false;
+        }
+        return true;
+    }
+    double recorded_ms() const;
+    double replayed_ms() const;
+};
+
+NODES_CORE_API nlohmann::json load_execution_recording(
+    const std::filesystem::path& path);
+
+// Rebuilds the recorded tree and runs it again on the given executor, feeding
+// the recorded inputs and payload, timing each run and comparing outputs.
+NODES_CORE_API ReplayReport replay_execution(
+    const nlohmann::json& recording,
+    std::shared_ptr<NodeTreeDescriptor> descriptor,
+    NodeTreeExecutor* executor);
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
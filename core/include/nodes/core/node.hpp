@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <variant>
 
@@ -180,6 +183,21 @@ struct NODES_CORE_API Node {
     friend struct SocketGroup;
 };
 
+/**
+ * struct SubTreeSource
+ * Serialized subtree shared by every group referencing the same content key.
+ * The parsed form is shared too, but each group decodes its own NodeTree
+ * from it, since nodes carry per-instance runtime state.
+ */
+struct SubTreeSource {
+    std::string serialized;
+    std::shared_ptr<const nlohmann::json> plan;
+    std::mutex mutex;
+};
+
+// Content key used for the "sub_trees" entries of a serialized tree.
+NODES_CORE_API std::string sub_tree_content_key(const std::string& serialized);
+
 /**
  * struct NodeGroup
  * It is a Nodetree.
@@ -190,8 +208,17 @@ struct NODES_CORE_API NodeGroup : public Node {
 
     NodeGroup(NodeTree* node_tree, int id, const char* idname);
     bool is_node_group() override;
+
+    // Groups loaded from a file keep their subtree serialized until it is
+    // first needed. Access the subtree through get_sub_tree(), which decodes
+    // it on demand; while the group is pending the raw member holds an empty
+    // placeholder tree. Every group owns its tree, identical groups only
+    // share the serialized form.
     std::shared_ptr<NodeTree> sub_tree;
 
+    NodeTree* get_sub_tree();
+    bool is_sub_tree_materialized() const;
+
     void serialize(nlohmann::json& value) override;
 
     NodeSocket* group_add_socket(
@@ -221,13 +248,21 @@ struct NODES_CORE_API NodeGroup : public Node {
         const char* name);
 
    private:
+    void set_pending_sub_tree(std::shared_ptr<SubTreeSource> source);
+    void materialize_sub_tree();
+    void bind_sub_tree_interface();
+
+    std::shared_ptr<SubTreeSource> pending_sub_tree_;
+    std::atomic<bool> sub_tree_pending_ = false;
+    std::mutex sub_tree_mutex_;
+
     std::map<NodeSocket*, NodeSocket*> input_mapping_from_interface_to_internal;
     std::map<NodeSocket*, NodeSocket*>
         output_mapping_from_interface_to_internal;
 
     // Internal Node, Holding the input and output sockets.
-    Node* group_in;
-    Node* group_out;
+    Node* group_in = nullptr;
+    Node* group_out = nullptr;
 };
 
 /* Socket declaration. */
@@ -316,6 +351,7 @@ class Decl : public SocketDeclaration {
             this->name.c_str(),
             this->in_out);
         socket->optional = optional;
+        socket->lazy = lazy;
         update_default_value(socket);
 
         return socket;
@@ -332,21 +368,24 @@ class Decl : public SocketDeclaration {
             }
             if constexpr (HasMin && HasMax && HasDefault) {
                 socket->dataField.value = default_value;
+                socket->mark_default_changed();
             }
             else if constexpr (HasDefault) {
                 socket->dataField.value = default_value;
+                socket->mark_default_changed();
             }
         }
     }
 
     // Only add the min field if the type has_min
-    std::conditional_t<HasMin, T, std::monostate> soft_min;
+    std::conditional_t<HasMin, T, std::monostate> soft_min{};
     // Only add the max field if the type has_max
-    std::conditional_t<HasMax, T, std::monostate> soft_max;
+    std::conditional_t<HasMax, T, std::monostate> soft_max{};
     // Only add the default field if the type has_default
-    std::conditional_t<HasDefault, T, std::monostate> default_value;
+    std::conditional_t<HasDefault, T, std::monostate> default_value{};
 
     bool optional = false;
+    bool lazy = false;
 };
 
 template<typename SocketDecl>
@@ -388,6 +427,14 @@ class SocketDeclarationBuilder : public BaseSocketDeclarationBuilder {
         decl_->optional = cond;
         return *this;
     }
+
+    // The upstream of a lazy input is only executed when the node reads the
+    // input, so branches a node does not take are never computed.
+    SocketDeclarationBuilder& lazy(bool cond = true)
+    {
+        decl_->lazy = cond;
+        return *this;
+    }
 };
 
 template<typename T>
@@ -569,6 +616,11 @@ struct NODES_CORE_API NodeTypeInfo {
 
     NodeTypeInfo& set_always_required(bool always_required);
     NodeTypeInfo& set_always_dirty(bool always_dirty);
+    NodeTypeInfo& set_payload_dependencies(std::vector<std::string> fields);
+    NodeTypeInfo& set_pure(bool pure);
+    NodeTypeInfo& set_thread_safe(bool thread_safe);
+    NodeTypeInfo& set_cost(float cost);
+    NodeTypeInfo& set_inplace_inputs(std::vector<std::string> inputs);
 
     float color[4] = { 0.3f, 0.5f, 0.7f, 1.0f };
     ExecFunction node_execute;
@@ -577,6 +629,21 @@ struct NODES_CORE_API NodeTypeInfo {
     bool ALWAYS_DIRTY = false;
     bool INVISIBLE = false;
 
+    // The outputs depend on the inputs only and nothing else is touched, so
+    // the executor may keep the previous result when the inputs hash equal.
+    bool PURE = false;
+    // node_execute may run concurrently with other nodes, and with itself on
+    // other values, e.g. the elements of a for-each zone
+    bool THREAD_SAFE = false;
+    // Relative execution cost, 0 when unknown
+    float COST = 0.0f;
+    // Inputs whose values the node may take over and modify in place
+    std::vector<std::string> inplace_inputs;
+
+    // Global payload fields the node reads, on top of those tracked at
+    // runtime. An empty string stands for the whole payload.
+    std::vector<std::string> payload_dependencies;
+
     NodeDeclaration static_declaration;
 
    private:
@@ -1,15 +1,55 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+
 #include "entt/meta/meta.hpp"
 #include "node.hpp"
 #include "nodes/core/api.h"
+#include "nodes/core/chunk_stream.hpp"
+#include "nodes/core/result_snapshot.hpp"
 
 RUZINO_NAMESPACE_OPEN_SCOPE
 struct NodeTreeExecutor;
+class ExecutionRecorder;
+struct MemoryReport;
 struct NodeSocket;
 struct Node;
 class NodeTree;
 
+// An output value produced away from the executor thread, see
+// ExeParams::set_output_async().
+struct PendingValue {
+    virtual ~PendingValue() = default;
+    virtual bool ready() const = 0;
+    // Waits if not ready yet, rethrows what the producer threw.
+    virtual entt::meta_any get() = 0;
+};
+
+template<typename T>
+struct FuturePendingValue : PendingValue {
+    explicit FuturePendingValue(std::future<T> future)
+        : future(std::move(future))
+    {
+    }
+
+    bool ready() const override
+    {
+        return future.wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+    }
+
+    entt::meta_any get() override
+    {
+        return entt::meta_any{ get_entt_ctx(), future.get() };
+    }
+
+    std::future<T> future;
+};
+
 struct NODES_CORE_API ExeParams {
     const Node& node_;
 
@@ -25,16 +65,21 @@ struct NODES_CORE_API ExeParams {
     template<typename T>
     T get_input(const char* identifier) const
     {
+        const int index = this->get_input_index(identifier);
+        evaluate_if_lazy(index);
+        if constexpr (
+            std::is_lvalue_reference_v<T> &&
+            !std::is_const_v<std::remove_reference_t<T>>) {
+            // The node may change the value through the reference
+            record_input_write(index);
+        }
         if constexpr (std::is_same_v<T, entt::meta_any>) {
-            const int index = this->get_input_index(identifier);
             return *inputs_[index];
         }
         else if constexpr (std::is_same_v<T, std::string>) {
-            const int index = this->get_input_index(identifier);
             return std::string(inputs_[index]->cast<std::string>().c_str());
         }
         else {
-            const int index = this->get_input_index(identifier);
             return inputs_[index]->cast<T>();
         }
     }
@@ -67,6 +112,7 @@ struct NODES_CORE_API ExeParams {
             this->get_input_group_indices(group_identifier);
         std::vector<entt::meta_any*> values;
         for (auto index : indices) {
+            record_input_write(static_cast<int>(index));
             values.push_back(inputs_[index]);
         }
         return values;
@@ -94,6 +140,41 @@ struct NODES_CORE_API ExeParams {
         }
     }
 
+    /**
+     * Store the output value once `value` is ready, for nodes waiting on I/O.
+     * The executor goes on with the nodes that do not depend on this one and
+     * resumes the downstream cone when the value arrives. Executors without
+     * support wait for it right here.
+     */
+    template<typename T>
+    void set_output_async(const char* identifier, std::future<T> value)
+    {
+        const int index = this->get_output_index(identifier);
+        auto pending =
+            std::make_shared<FuturePendingValue<T>>(std::move(value));
+        if (!defer_output(index, pending)) {
+            *outputs_[index] = pending->get();
+        }
+    }
+
+    /**
+     * The stream of a ChunkStream<T> output, to push chunks into and close
+     * when done. The eager executor runs this node on its own thread and has
+     * handed the stream to the consumers already, so it fails nodes that also
+     * have outputs of other types. Other executors give an unbounded stream,
+     * consumed once this node returned.
+     */
+    template<typename T>
+    ChunkStream<T> get_output_stream(const char* identifier)
+    {
+        const int index = this->get_output_index(identifier);
+        if (!*outputs_[index]) {
+            *outputs_[index] =
+                entt::meta_any{ get_entt_ctx(), ChunkStream<T>{ 0 } };
+        }
+        return outputs_[index]->cast<ChunkStream<T>>();
+    }
+
     template<typename T>
     T get_storage()
     {
@@ -118,15 +199,35 @@ struct NODES_CORE_API ExeParams {
         }
     }
 
+    // The node is taken to depend on the whole payload, see
+    // NodeTreeExecutor::notify_global_payload_changed().
     template<typename T>
     T get_global_payload()
     {
+        record_payload_read(nullptr);
         if (!global_param) {
             throw std::runtime_error("Global payload is not set");
         }
         return global_param.cast<T>();
     }
 
+    // Same payload, but the node only depends on `field`, so changes to other
+    // fields leave its result cached.
+    template<typename T>
+    T get_global_payload(const char* field)
+    {
+        record_payload_read(field);
+        if (!global_param) {
+            throw std::runtime_error("Global payload is not set");
+        }
+        return global_param.cast<T>();
+    }
+
+    // Preview asks for a fast approximation. Reading it makes the node
+    // execute again when the quality changes, see
+    // NodeTreeExecutor::set_quality().
+    ExecutionQuality get_quality() const;
+
     NodeTreeExecutor* get_executor() const
     {
         return executor;
@@ -173,6 +274,10 @@ struct NODES_CORE_API ExeParams {
     }
 
    private:
+    void record_payload_read(const char* field) const;
+    void record_input_write(int index) const;
+    bool defer_output(int index, std::shared_ptr<PendingValue> value);
+    void evaluate_if_lazy(int index) const;
     int get_input_index(const char* identifier) const;
     std::vector<size_t> get_input_group_indices(
         const char* group_identifier) const;
@@ -184,6 +289,7 @@ struct NODES_CORE_API ExeParams {
     friend class EagerNodeTreeExecutor;
     friend class EagerNodeTreeExecutorGeom;
     friend class EagerNodeTreeExecutorRender;
+    friend class PipelinedTreeExecutor;
 
     template<typename T>
     friend T& force_get_output_to_execute(
@@ -194,10 +300,18 @@ struct NODES_CORE_API ExeParams {
     entt::meta_any& global_param;
     std::vector<entt::meta_any*> inputs_;
     std::vector<entt::meta_any*> outputs_;
+    // Per input, the lazy socket still waiting for its upstream. Empty when
+    // the node has no lazy inputs.
+    mutable std::vector<NodeSocket*> lazy_inputs_;
+
+    ExecutionQuality quality = ExecutionQuality::Final;
 
     // Subtree execution
-    NodeTreeExecutor* executor;  // For node group execution
-    NodeTree* subtree;
+    NodeTreeExecutor* executor = nullptr;  // For node group execution
+    NodeTree* subtree = nullptr;
+
+    // Receives set_error() instead of the node, for runs sharing the node
+    std::string* error_ = nullptr;
 };
 
 template<typename T>
@@ -213,6 +327,38 @@ T& force_get_output_to_execute(ExeParams& params, const char* identifier)
     }
 }
 
+// Operation counts accumulated by an executor until reset_counters(). Unlike
+// timings they are deterministic, so tests can assert on them.
+struct ExecutorCounters {
+    size_t nodes_executed = 0;
+    // Missing inputs, or node_execute returned false
+    size_t nodes_failed = 0;
+    // Clean, with all inputs and outputs cached
+    size_t nodes_skipped = 0;
+    size_t frame_cache_hits = 0;
+    // Results restored from those of the same quality, see set_quality()
+    size_t quality_cache_hits = 0;
+    // Dirty pure nodes whose inputs hashed equal to their last execution
+    size_t pure_reuses = 0;
+    // Executions completed through set_output_async(), also counted in
+    // nodes_executed
+    size_t async_completions = 0;
+    // Bodies of for-each zones run, one per element
+    size_t foreach_iterations = 0;
+    // Output values copied into linked inputs
+    size_t values_copied = 0;
+    // Socket defaults copied into inputs, only when their version moved
+    size_t defaults_copied = 0;
+    // Socket values default-constructed by prepare_memory
+    size_t values_constructed = 0;
+    // Clean to dirty transitions of a node
+    size_t dirty_marks = 0;
+    // func_storage name lookups
+    size_t storage_lookups = 0;
+    // Current size of the values kept across prepare_tree(), not accumulated
+    size_t persistent_cache_bytes = 0;
+};
+
 // This executes a tree. The execution strategy is left to its children.
 struct NODES_CORE_API NodeTreeExecutor {
    public:
@@ -225,6 +371,34 @@ struct NODES_CORE_API NodeTreeExecutor {
         NodeTree* tree,
         Node* required_node = nullptr) = 0;
     virtual void execute_tree(NodeTree* tree) = 0;
+
+    // Executes the prepared tree for about `budget_ms`, and at least one
+    // node. Returns true once the run is complete; otherwise the position is
+    // kept and the next call continues from there. Preparing the tree in
+    // between restarts the run, keeping what the executed nodes produced.
+    virtual bool execute_tree_for(NodeTree* tree, double budget_ms)
+    {
+        execute_tree(tree);
+        return true;
+    }
+
+    // A time-sliced run was started and not completed yet.
+    virtual bool has_unfinished_run() const
+    {
+        return false;
+    }
+
+    // Makes the running execute_tree_for() return at the next node boundary,
+    // as if its budget was spent, so a more urgent run can go first. Any
+    // thread. execute_tree() does not stop for it.
+    void request_pause()
+    {
+        pause_requested.store(true, std::memory_order_relaxed);
+    }
+    void clear_pause_request()
+    {
+        pause_requested.store(false, std::memory_order_relaxed);
+    }
     virtual void finalize(NodeTree* tree)
     {
     }
@@ -236,12 +410,57 @@ struct NODES_CORE_API NodeTreeExecutor {
 
     virtual std::shared_ptr<NodeTreeExecutor> clone_empty() const = 0;
 
+    // A new executor holding the results of this one, for evaluating a
+    // variant of the tree side by side with it: only what the variant dirties
+    // executes again. Defaults written through the fork with
+    // sync_node_from_external_storage() stay in the fork, the tree keeps its
+    // own. Null when not supported, or when the tree holds node state (zone
+    // pairs, node groups, nodes with storage): it lives on the nodes, which
+    // the fork shares.
+    virtual std::shared_ptr<NodeTreeExecutor> fork()
+    {
+        return nullptr;
+    }
+
+    // Writes the defaults changed in `fork` to the tree and takes over its
+    // results, leaving the fork empty. Prepare the tree again before reading
+    // values. False when `fork` was not forked from this executor.
+    virtual bool commit_fork(NodeTreeExecutor& fork)
+    {
+        return false;
+    }
+
     virtual void sync_node_to_external_storage(
         NodeSocket* socket,
         entt::meta_any& data)
     {
     }
 
+    // Sets many inputs at once, as sync_node_from_external_storage() would.
+    // The values are moved from, and executors with dirty tracking walk the
+    // downstream of all changed inputs in a single pass.
+    virtual void sync_batch_from_external_storage(
+        std::vector<std::pair<NodeSocket*, entt::meta_any>>& inputs)
+    {
+        for (auto& [socket, value] : inputs) {
+            sync_node_from_external_storage(socket, value);
+        }
+    }
+
+    // The runtime values of `sockets` without copying them. They stay valid
+    // until the next prepare_tree() or execute_tree(). Executors keeping no
+    // values give null.
+    std::vector<const entt::meta_any*> borrow_socket_values(
+        const std::vector<NodeSocket*>& sockets)
+    {
+        std::vector<const entt::meta_any*> values;
+        values.reserve(sockets.size());
+        for (auto* socket : sockets) {
+            values.push_back(get_socket_value(socket));
+        }
+        return values;
+    }
+
     // Notify executor that a node or socket has been modified
     virtual void notify_node_dirty(Node* node)
     {
@@ -289,21 +508,154 @@ struct NODES_CORE_API NodeTreeExecutor {
         return global_payload.cast<T>();
     }
 
-    // Set global payload directly (for type-erased setting)
-    void set_global_payload(const entt::meta_any& payload)
+    // Set global payload directly (for type-erased setting). `fields` names
+    // what changed, empty meaning all of it. An equal payload dirties nothing.
+    void set_global_payload(
+        const entt::meta_any& payload,
+        const std::vector<std::string>& fields = {})
     {
+        if (global_payload && payload && global_payload == payload) {
+            return;
+        }
         global_payload = payload;
+        notify_global_payload_changed(fields);
+    }
+
+    // Dirties the nodes that read any of `fields` from the global payload,
+    // and everything downstream of them. A node depends on the fields its
+    // type declares in payload_dependencies and on those it read through
+    // ExeParams::get_global_payload(field) when it last executed; reading
+    // without a field depends on the whole payload. An empty `fields` means
+    // the whole payload changed. Call it after writing to the payload through
+    // get_global_payload<T&>().
+    virtual void notify_global_payload_changed(
+        const std::vector<std::string>& fields = {})
+    {
+    }
+
+    // Called by ExeParams, `field` is empty for the whole payload
+    virtual void track_global_payload_read(Node* node, const char* field)
+    {
+    }
+
+    // Quality of the next runs. Changing it dirties the nodes that read it
+    // in their last execution and everything downstream of them. The eager
+    // executor keeps their results per quality, so a preview run never
+    // replaces the final results and switching back restores them.
+    virtual void set_quality(ExecutionQuality quality)
+    {
+        this->quality = quality;
+    }
+
+    ExecutionQuality get_quality() const
+    {
+        return quality;
+    }
+
+    // Called by ExeParams::get_quality()
+    virtual void track_quality_read(Node* node)
+    {
+    }
+
+    // Called when the executing node gets write access to an input value,
+    // which may be the executor's copy of the socket default.
+    virtual void track_input_write(NodeSocket* socket)
+    {
+    }
+
+    // Runs the upstream of a lazy input, called by ExeParams the first time
+    // the executing node reads it.
+    virtual void evaluate_lazy_input(NodeSocket* socket)
+    {
+    }
+
+    // Called by ExeParams::set_output_async(). False makes the node wait for
+    // the value itself.
+    virtual bool defer_output(
+        Node* node,
+        int output_index,
+        std::shared_ptr<PendingValue> value)
+    {
+        return false;
     }
 
     virtual void mark_tree_structure_changed() { };
 
+    // Frame-keyed result cache for animated graphs. While enabled, outputs of
+    // the time-dependent cone (ALWAYS_DIRTY nodes and everything downstream)
+    // are kept per frame; revisiting a frame restores them instead of
+    // executing. The frame number still has to reach the nodes through the
+    // global payload, set_frame() only selects the cache slot.
+    virtual void enable_frame_cache(
+        size_t frame_budget_bytes,
+        size_t max_frames = 0)
+    {
+    }
+
+    virtual void disable_frame_cache()
+    {
+    }
+
+    virtual void set_frame(int64_t frame)
+    {
+    }
+
+    virtual ExecutorCounters get_counters() const
+    {
+        return {};
+    }
+
+    virtual void reset_counters()
+    {
+    }
+
+    // Estimated bytes of every value the executor retains, see value_size.hpp.
+    virtual MemoryReport memory_report() const;
+
+    // Why the node executed in the last run, as readable text
+    virtual std::string explain_execution(Node* node) const
+    {
+        return "execution tracing is not supported by this executor";
+    }
+
     // Reset resource allocator (for render executors)
     virtual void reset_allocator()
     {
     }
 
+    // Record external inputs, payload and outputs of every run, see
+    // execution_recorder.hpp. Pass nullptr to stop recording.
+    void set_recorder(std::shared_ptr<ExecutionRecorder> recorder)
+    {
+        this->recorder = std::move(recorder);
+    }
+
+    std::shared_ptr<ExecutionRecorder> get_recorder() const
+    {
+        return recorder;
+    }
+
+    // Called on the executing thread between two nodes of a run. Whatever it
+    // does must leave the structure of the running cone alone.
+    void set_safe_point(std::function<void()> callback)
+    {
+        safe_point = std::move(callback);
+    }
+
+    // Values of subscribed sockets, published after every run for readers on
+    // other threads, see result_snapshot.hpp.
+    ResultPublisher& results()
+    {
+        return result_publisher;
+    }
+
    protected:
     entt::meta_any global_payload;
+    std::shared_ptr<ExecutionRecorder> recorder;
+    ResultPublisher result_publisher;
+    std::function<void()> safe_point;
+    std::atomic<bool> pause_requested{ false };
+    ExecutionQuality quality = ExecutionQuality::Final;
 };
 
 struct NodeTreeExecutorDesc {
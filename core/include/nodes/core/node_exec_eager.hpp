@@ -1,9 +1,12 @@
 #pragma once
+#include <future>
 #include <map>
+#include <optional>
 #include <set>
 #include <vector>
 
 #include "entt/meta/meta.hpp"
+#include "nodes/core/chunk_stream.hpp"
 #include "nodes/core/node_exec.hpp"
 #include "nodes/core/node_tree.hpp"
 
@@ -17,6 +20,9 @@ struct RuntimeInputState {
     bool is_last_used = false;
     bool keep_alive = false;
     bool is_cached = false;  // Cache validity flag
+    // Version of the socket default held in `value`, 0 when it holds
+    // something else
+    uint64_t default_version = 0;
 };
 
 struct RuntimeOutputState {
@@ -25,6 +31,44 @@ struct RuntimeOutputState {
     bool is_cached = false;  // Cache validity flag
 };
 
+// What made a node dirty, or execute, see explain_execution().
+enum class DirtyCause : uint8_t {
+    NodeNotified,
+    SocketNotified,
+    // sync_node_from_external_storage() with a different value
+    ExternalInput,
+    // Downstream of a node that became dirty
+    UpstreamDirty,
+    // forward_output_to_input() delivered a different value
+    InputChanged,
+    AlwaysDirty,
+    // prepare_memory() dropped a cached value of the wrong type
+    TypeMismatch,
+    // mark_tree_structure_changed(), concerns every node
+    StructureChanged,
+    // set_nodes_dirty()
+    Restored,
+    // notify_global_payload_changed() with a field the node depends on
+    PayloadChanged,
+    // The version of an unlinked input's default value moved
+    DefaultChanged,
+    // set_quality() with a node reading the quality
+    QualityChanged,
+};
+
+NODES_CORE_API const char* dirty_cause_name(DirtyCause cause);
+
+// IDs rather than pointers, the nodes may be gone by the time anyone asks.
+struct DirtyEvent {
+    uint64_t sequence = 0;  // Starts at 1, 0 means no event
+    uint64_t run = 0;       // Number of execute_tree() calls before it
+    DirtyCause cause = DirtyCause::NodeNotified;
+    unsigned node = 0;
+    unsigned socket = 0;
+    unsigned source = 0;  // The upstream node that passed the cause on
+    uint64_t parent = 0;  // The event that made `source` dirty
+};
+
 // Provide single threaded execution. The aim of this executor is simplicity and
 // robustness.
 
@@ -34,15 +78,22 @@ class NODES_CORE_API EagerNodeTreeExecutor : public NodeTreeExecutor {
     void prepare_memory();
     void prepare_tree(NodeTree* tree, Node* required_node = nullptr) override;
     void execute_tree(NodeTree* tree) override;
+    bool execute_tree_for(NodeTree* tree, double budget_ms) override;
+    bool has_unfinished_run() const override;
 
+    // Null for sockets the executor holds no value for
     entt::meta_any* FindPtr(NodeSocket* socket);
     void sync_node_from_external_storage(
         NodeSocket* socket,
         const entt::meta_any& data) override;
     void sync_node_to_external_storage(NodeSocket* socket, entt::meta_any& data)
         override;
+    void sync_batch_from_external_storage(
+        std::vector<std::pair<NodeSocket*, entt::meta_any>>& inputs) override;
 
     std::shared_ptr<NodeTreeExecutor> clone_empty() const override;
+    std::shared_ptr<NodeTreeExecutor> fork() override;
+    bool commit_fork(NodeTreeExecutor& fork) override;
 
     // Override base class notification methods
     void notify_node_dirty(Node* node) override;
@@ -50,7 +101,11 @@ class NODES_CORE_API EagerNodeTreeExecutor : public NodeTreeExecutor {
     entt::meta_any* get_socket_value(NodeSocket* socket) override;
 
     // Dirty tracking and cache management
-    void mark_node_dirty(Node* node);
+    void mark_node_dirty(
+        Node* node,
+        DirtyCause cause = DirtyCause::NodeNotified,
+        Node* source = nullptr,
+        NodeSocket* socket = nullptr);
     void mark_socket_dirty(NodeSocket* socket);
     void mark_tree_structure_changed()
         override;                          // Call when links added/removed
@@ -60,16 +115,78 @@ class NODES_CORE_API EagerNodeTreeExecutor : public NodeTreeExecutor {
     std::set<Node*> get_dirty_nodes() const;
     void set_nodes_dirty(const std::set<Node*>& nodes);
 
+    void notify_global_payload_changed(
+        const std::vector<std::string>& fields = {}) override;
+    void track_global_payload_read(Node* node, const char* field) override;
+    void set_quality(ExecutionQuality quality) override;
+    void track_quality_read(Node* node) override;
+    void track_input_write(NodeSocket* socket) override;
+    void evaluate_lazy_input(NodeSocket* socket) override;
+    bool defer_output(
+        Node* node,
+        int output_index,
+        std::shared_ptr<PendingValue> value) override;
+    bool depends_on_payload(
+        Node* node,
+        const std::vector<std::string>& fields) const;
+
+    void enable_frame_cache(size_t frame_budget_bytes, size_t max_frames = 0)
+        override;
+    void disable_frame_cache() override;
+    void set_frame(int64_t frame) override;
+    bool is_frame_cached(int64_t frame) const;
+
+    ExecutorCounters get_counters() const override;
+    void reset_counters() override;
+    MemoryReport memory_report() const override;
+
+    // The cause chain of a node's execution in the last run, the node's own
+    // event first. Empty when it did not execute or had no cached result.
+    std::vector<DirtyEvent> dirty_cause_chain(Node* node) const;
+    std::string explain_execution(Node* node) const override;
+    // Number of dirty events kept, 0 turns recording off.
+    void set_dirty_trace_capacity(size_t capacity);
+
    protected:
     virtual ExeParams prepare_params(NodeTree* tree, Node* node);
     virtual bool execute_node(NodeTree* tree, Node* node);
+    // Executes, or skips when clean and cached, then forwards the outputs
+    void run_node(NodeTree* tree, Node* node);
+    // Forwards the outputs of a successful execution and marks it clean
+    void finish_node(Node* node, bool reused_pure);
+    bool waits_on_pending(Node* node) const;
+    void complete_pending(NodeTree* tree, Node* node);
+    // Counts and reports a node whose execution failed
+    void report_failure(NodeTree* tree, Node* node);
+    // Completes the pending nodes whose values arrived, waiting for them when
+    // `wait` is set, and runs the postponed nodes no longer waiting.
+    void resume_pending(NodeTree* tree, bool wait);
+    void begin_run(NodeTree* tree);
+    void finish_run(NodeTree* tree);
+    // Copies the runtime states to the persistent caches
+    void save_states();
+    // Hash of everything a pure node reads, nullopt when some value has no
+    // hasher, see value_hash.hpp.
+    std::optional<size_t> hash_pure_inputs(
+        Node* node,
+        const ExeParams& params) const;
+    bool has_pure_result(Node* node, size_t input_hash) const;
     virtual void remove_storage(const std::set<std::string>::value_type& key);
+    // Stores an external value, true when an input changed
+    bool apply_external_input(NodeSocket* socket, entt::meta_any&& data);
+    void mark_external_inputs_dirty(const std::vector<NodeSocket*>& sockets);
     void forward_output_to_input(Node* node);
     void clear();
 
     // Cache management
-    void propagate_dirty_downstream(Node* node, NodeTree* tree);
+    void propagate_dirty_downstream(
+        Node* node,
+        NodeTree* tree,
+        DirtyCause cause = DirtyCause::NodeNotified);
     void collect_required_upstream(Node* node);
+    void collect_deferred_upstream(Node* node);
+    // Dirties the nodes whose defaults were written since they last read them
+    void detect_default_changes(NodeTree* tree);
     void invalidate_cache_for_node(Node* node);
     void mark_node_clean(Node* node);
 
@@ -80,6 +197,92 @@ class NODES_CORE_API EagerNodeTreeExecutor : public NodeTreeExecutor {
     std::vector<NodeSocket*> input_of_nodes_to_execute;
     std::vector<NodeSocket*> output_of_nodes_to_execute;
     ptrdiff_t nodes_to_execute_count = 0;
+    // Position in nodes_to_execute of a time-sliced run
+    ptrdiff_t execution_cursor = 0;
+    bool run_in_progress = false;
+    // Structure the execution state was prepared for
+    NodeTree* prepared_tree = nullptr;
+    uint64_t prepared_structure_version = 0;
+    bool structure_changed_since_prepare(NodeTree* tree) const;
+
+    // Required only through lazy inputs. They have memory and their place
+    // in nodes_to_execute, but only run from evaluate_lazy_input().
+    std::set<Node*> deferred_nodes;
+    std::set<Node*> evaluated_deferred_nodes;
+    NodeTree* executing_tree = nullptr;
+
+    // Outputs of executed nodes still being produced, by output index, see
+    // ExeParams::set_output_async().
+    std::map<Node*, std::vector<std::pair<int, std::shared_ptr<PendingValue>>>>
+        pending_outputs;
+    // Planned nodes downstream of a pending one, in plan order
+    std::vector<Node*> postponed_nodes;
+    // Pending and postponed nodes
+    std::set<Node*> waiting_nodes;
+
+    // Nodes with ChunkStream outputs. They execute whenever planned, like
+    // ALWAYS_DIRTY ones, since a stream is consumed once.
+    bool produces_streams(Node* node) const;
+    bool always_dirty(Node* node) const;
+    // Runs the node on its own thread, its consumers pulling meanwhile
+    void start_streaming_node(Node* node, ExeParams params);
+    // Waits for the streaming nodes of the run, cancelling the streams left
+    // undrained. Failures are set on the nodes only when they still exist.
+    void finish_streaming_nodes(bool nodes_alive = true);
+
+    struct StreamingNode {
+        Node* node;
+        std::vector<std::shared_ptr<ChunkChannelBase>> streams;
+        // Why it failed, empty on success
+        std::future<std::string> failure;
+    };
+    std::set<Node*> stream_producers;
+    // Producers with outputs of other types too. Those would be forwarded
+    // while the producer thread still writes them, they are rejected.
+    std::set<Node*> mixed_stream_producers;
+    std::vector<StreamingNode> streaming_nodes;
+
+    // For-each zones, compiled once per prepare_tree(). The body only runs
+    // from run_foreach_zone(), on a slot of values per iteration.
+    struct ForEachZone {
+        Node* begin = nullptr;
+        // Between begin and end, in plan order
+        std::vector<Node*> body;
+        // Slot index of the outputs of begin and the sockets of the body
+        std::map<NodeSocket*, size_t> slot_index;
+        // Every body node is THREAD_SAFE and none is a node group
+        bool parallel = true;
+        // Why the body cannot run per element, empty if it can
+        std::string error;
+    };
+    void compile_foreach_zones();
+    bool run_foreach_zone(Node* end, ExeParams& params);
+    // Empty on success
+    std::string run_foreach_iteration(
+        const ForEachZone& zone,
+        Node* end,
+        size_t index,
+        const entt::meta_any& element,
+        std::vector<entt::meta_any>& slot,
+        entt::meta_any& result);
+    // Outer value of an input read inside a zone
+    const entt::meta_any* zone_outer_value(NodeSocket* input) const;
+
+    // By end node
+    std::map<Node*, ForEachZone> foreach_zones;
+    std::set<Node*> zone_body_nodes;
+
+    // The executor this one was forked from, null otherwise
+    const EagerNodeTreeExecutor* fork_parent = nullptr;
+    // Defaults written through a fork, read instead of those of the tree
+    std::map<NodeSocket*, entt::meta_any> default_overrides;
+    // Default of an unlinked input as seen by this executor, null for none
+    const entt::meta_any* default_value(NodeSocket* input) const;
+
+    // Input hash of each pure node's last successful execution
+    std::map<Node*, size_t> pure_input_hashes;
+    // Set by execute_node() when it kept the previous result
+    bool reused_pure_result = false;
 
     // Persistent cache - survives across prepare_memory() calls
     std::map<NodeSocket*, RuntimeInputState> persistent_input_cache;
@@ -88,6 +291,79 @@ class NODES_CORE_API EagerNodeTreeExecutor : public NodeTreeExecutor {
     // Dirty tracking
     std::set<Node*> dirty_nodes;
     std::map<Node*, bool> node_dirty_cache;  // Cache dirty state per node
+    // Payload fields each node read in its last execution, "" for all of it
+    std::map<Node*, std::vector<std::string>> payload_reads;
+
+    // Frame cache. Only the time-dependent cone is stored, minus the nodes
+    // holding state and their downstream, which execute every frame. A frame
+    // stops taking entries once its budget is used up, the nodes left out
+    // simply execute again. With max_frames set, the least recently used
+    // frame is evicted.
+    struct CachedFrame {
+        std::map<Node*, std::vector<entt::meta_any>> outputs;
+        size_t bytes = 0;
+        uint64_t last_used = 0;
+    };
+
+    void collect_time_dependent_nodes();
+    bool is_frame_cacheable(Node* node) const;
+    bool restore_frame_outputs(Node* node);
+    void store_frame_outputs(Node* node);
+    // Drops the cached frames and qualities, called whenever anything but
+    // the frame or the quality changed
+    void invalidate_result_caches();
+
+    bool frame_cache_enabled = false;
+    size_t frame_cache_budget = 0;
+    size_t frame_cache_max_frames = 0;
+    std::optional<int64_t> current_frame;
+    // Frame of the last begin_run()
+    std::optional<int64_t> last_run_frame;
+    // A node read what notify_global_payload_changed() reported
+    bool payload_changed_since_run = false;
+    uint64_t frame_cache_clock = 0;
+    std::map<int64_t, CachedFrame> frame_cache;
+    std::set<Node*> time_dependent_nodes;
+    std::set<Node*> stateful_nodes;
+
+    // Quality cache. The results of the nodes depending on the quality are
+    // kept per quality, so switching back to one restores them, e.g. the
+    // final results after a preview. Nodes that are always dirty, streaming
+    // ones included, and their downstream execute again instead.
+    bool restore_quality_outputs(Node* node);
+    void store_quality_outputs(Node* node);
+
+    // Nodes that read the quality in their last execution
+    std::set<Node*> quality_readers;
+    // Those and the nodes downstream of them
+    std::set<Node*> quality_dependent_nodes;
+    // always_dirty() nodes and the nodes downstream of them
+    std::set<Node*> always_dirty_cone;
+    std::map<ExecutionQuality, std::map<Node*, std::vector<entt::meta_any>>>
+        quality_cache;
+
+    ExecutorCounters counters;
+
+    // Dirty provenance, a ring buffer of the latest events
+    void record_dirty_event(
+        DirtyCause cause,
+        Node* node,
+        Node* source = nullptr,
+        NodeSocket* socket = nullptr);
+    const DirtyEvent* find_dirty_event(uint64_t sequence) const;
+
+    std::vector<DirtyEvent> dirty_events;
+    size_t dirty_event_capacity = 1024;
+    uint64_t dirty_event_count = 0;
+    uint64_t run_count = 0;
+    uint64_t structure_changed_event = 0;
+    // The event a node is currently dirty for
+    std::map<Node*, uint64_t> node_dirty_event;
+    // Nodes executed by the last run and the event each executed for
+    std::map<Node*, uint64_t> executed_last_run;
+
+    // Snapshots the subscribed sockets, see ResultPublisher
+    void publish_results(NodeTree* tree);
 
     // Storage related
     virtual void refresh_storage();
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "entt/meta/meta.hpp"
+#include "nodes/core/api.h"
+#include "nodes/core/result_snapshot.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+struct Node;
+struct NodeSocket;
+class NodeTree;
+struct NodeTreeExecutor;
+
+/**
+ * class PipelinedTreeExecutor
+ * Executes one tree over a stream of frames, using the topological levels of
+ * the tree as pipeline stages. While a downstream stage works on frame N, the
+ * upstream stages already work on the frames after it. Throughput then
+ * approaches that of the slowest stage rather than that of the whole tree.
+ *
+ * Each stage runs on its own thread and each frame in flight has its own slot
+ * of socket values. Frames complete in submission order. Node types not
+ * marked THREAD_SAFE never run concurrently with each other.
+ *
+ * The structure of the tree is taken on construction and nothing is cached
+ * between frames. The tree must not be edited while the executor lives; use
+ * the eager executor for interactive evaluation.
+ */
+class NODES_CORE_API PipelinedTreeExecutor {
+   public:
+    struct Frame {
+        entt::meta_any global_payload;
+        // Values replacing the defaults of these inputs for this frame
+        std::vector<std::pair<NodeSocket*, entt::meta_any>> inputs;
+    };
+
+    // Runs the nodes `outputs` depend on and collects the values of
+    // `outputs` for every frame. At most `max_in_flight` frames are in
+    // flight, one per stage when 0.
+    PipelinedTreeExecutor(
+        NodeTree* tree,
+        std::vector<NodeSocket*> outputs,
+        size_t max_in_flight = 0);
+    // Completes the frames in flight first.
+    ~PipelinedTreeExecutor();
+
+    PipelinedTreeExecutor(const PipelinedTreeExecutor&) = delete;
+    PipelinedTreeExecutor& operator=(const PipelinedTreeExecutor&) = delete;
+
+    // Blocks while `max_in_flight` frames are in flight. Returns the frame
+    // number, from 1.
+    uint64_t submit(Frame frame);
+
+    // The values of the oldest frame not taken yet, waiting for it to
+    // complete. The epoch is the frame number. Outputs of failed nodes are
+    // missing. Null when no frame was submitted since the last one taken.
+    std::shared_ptr<const ResultSnapshot> next_result();
+
+    size_t stage_count() const;
+
+   private:
+    struct Slot {
+        uint64_t frame = 0;
+        entt::meta_any global_payload;
+        // Indexed by socket_index
+        std::vector<entt::meta_any> values;
+        std::vector<bool> provided;
+    };
+
+    struct Stage {
+        std::vector<Node*> nodes;
+        std::deque<Slot*> queue;
+        std::thread thread;
+        // Handed to the nodes, node groups clone their executors from it
+        std::unique_ptr<NodeTreeExecutor> host;
+    };
+
+    void compile(NodeTree* tree);
+    void stage_loop(size_t index);
+    void run_node(Node* node, Slot& slot, NodeTreeExecutor* host);
+    void complete(Slot* slot);
+
+    std::vector<NodeSocket*> outputs;
+    std::unordered_map<NodeSocket*, size_t> socket_index;
+    std::vector<std::unique_ptr<Stage>> stages;
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    // Guards everything below, and the stage queues
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<Slot*> free_slots;
+    std::deque<std::shared_ptr<const ResultSnapshot>> results;
+    uint64_t frames_submitted = 0;
+    size_t in_flight = 0;
+    bool stopping = false;
+
+    // Held by nodes not marked THREAD_SAFE
+    std::mutex exclusive_mutex;
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -17,11 +17,20 @@ RUZINO_NAMESPACE_OPEN_SCOPE
 #define NODE_GROUP_IN_IDENTIFIER  "node_group_in"
 #define NODE_GROUP_OUT_IDENTIFIER "node_group_out"
 
+#define FOREACH_BEGIN_IDENTIFIER "foreach_begin"
+#define FOREACH_END_IDENTIFIER   "foreach_end"
+
 #define OutsideInputsPH  "Outside_Inputs_PH"
 #define OutsideOutputsPH "Outside_Outputs_PH"
 #define InsideInputsPH   "Inside_Inputs_PH"
 #define InsideOutputsPH  "Inside_Outputs_PH"
 
+// Storage of a group node, the executor running its subtree.
+struct NodeGroupStorage {
+    std::shared_ptr<NodeTreeExecutor> executor = nullptr;
+    static constexpr bool has_storage = false;
+};
+
 // Multiple definitions of trees
 class NODES_CORE_API NodeTreeDescriptor {
    public:
@@ -148,6 +157,10 @@ class NODES_CORE_API NodeTree {
 
     void ungroup(Node* node);
 
+    // Decode all pending group subtrees up front. Independent subtrees are
+    // decoded in parallel; nested groups too when recursive is set.
+    void materialize_sub_trees(bool recursive = true);
+
     unsigned UniqueID();
 
     void update_socket_vectors_and_owner_node();
@@ -223,16 +236,23 @@ class NODES_CORE_API NodeTree {
     std::string serialize() const;
 
     void deserialize(const std::string& str);
+    void deserialize(const nlohmann::json& value);
 
     void SetDirty(bool dirty = true);
 
     bool GetDirty();
 
+    // Moves whenever a node, socket or link is added or removed, so holders
+    // of such pointers can tell whether they are still valid.
+    uint64_t structure_version() const;
+    void bump_structure_version();
+
     // Debug utility: Print tree structure
     std::string print_tree_structure() const;
 
    private:
     bool dirty_ = true;
+    uint64_t structure_version_ = 0;
 };
 
 RUZINO_NAMESPACE_CLOSE_SCOPE
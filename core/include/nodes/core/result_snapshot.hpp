@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "entt/meta/meta.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+struct NodeSocket;
+
+// What the nodes are asked for, see ExeParams::get_quality().
+enum class ExecutionQuality {
+    // Fast approximations for interactive feedback
+    Preview,
+    Final,
+};
+
+/**
+ * struct ResultSnapshot
+ * The values of the subscribed sockets after one run. A snapshot never
+ * changes once published; values that did not change between runs are
+ * shared with the previous snapshot.
+ */
+struct NODES_CORE_API ResultSnapshot {
+    // Number of execute_tree() calls of the publishing executor, from 1
+    uint64_t epoch = 0;
+    // The quality of the run, a final run may follow a preview one
+    ExecutionQuality quality = ExecutionQuality::Final;
+    // Keyed by socket ID
+    std::unordered_map<unsigned, std::shared_ptr<const entt::meta_any>>
+        values;
+
+    // Null when the socket had no value in this run.
+    const entt::meta_any* find(NodeSocket* socket) const;
+};
+
+/**
+ * class ResultPublisher
+ * Hands the results of a run to readers on other threads. The executor
+ * swaps in a new snapshot after each run; readers take the latest one
+ * without waiting for execution and keep it alive for as long as they hold
+ * it, so prepare_tree() rebuilding the runtime state never pulls values from
+ * under them.
+ *
+ * Reach it with NodeTreeExecutor::results().
+ */
+class NODES_CORE_API ResultPublisher {
+   public:
+    // Sockets are kept by ID, deleting one only drops it from snapshots.
+    void subscribe(NodeSocket* socket);
+    void unsubscribe(NodeSocket* socket);
+    std::vector<unsigned> subscriptions() const;
+
+    // Null before the first run with subscriptions.
+    std::shared_ptr<const ResultSnapshot> latest() const;
+    uint64_t epoch() const;
+
+    // Called by the executor.
+    void publish(std::shared_ptr<const ResultSnapshot> snapshot);
+
+   private:
+    mutable std::mutex subscriptions_mutex_;
+    std::set<unsigned> subscriptions_;
+    std::atomic<std::shared_ptr<const ResultSnapshot>> snapshot_;
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
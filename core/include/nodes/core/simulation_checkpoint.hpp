@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "io/json.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+class NodeTree;
+struct NodeTreeExecutor;
+
+// Zone storage of a tree: the storage of every simulation_in node, keyed by
+// node ID and converted through the value serializer registry. Storage whose
+// type has no serializer is skipped with a warning.
+NODES_CORE_API nlohmann::json capture_simulation_state(NodeTree* tree);
+
+// Puts captured storage back on the simulation_in nodes. Restored nodes are
+// reported dirty to the executor, when one is given.
+NODES_CORE_API bool restore_simulation_state(
+    NodeTree* tree,
+    const nlohmann::json& state,
+    NodeTreeExecutor* executor = nullptr);
+
+/**
+ * class SimulationCheckpointFile
+ * Append-only file of per-frame simulation states. Each chunk is
+ * [int64 frame][uint64 size][CBOR payload]; the frame index is rebuilt by
+ * scanning chunk headers when the file is opened, so a truncated tail only
+ * loses the frame being written; it is cut off before appending. A later
+ * chunk for the same frame wins.
+ * Writes are queued and performed on a background thread.
+ */
+class NODES_CORE_API SimulationCheckpointFile {
+   public:
+    explicit SimulationCheckpointFile(std::filesystem::path path);
+    ~SimulationCheckpointFile();
+
+    SimulationCheckpointFile(const SimulationCheckpointFile&) = delete;
+    SimulationCheckpointFile& operator=(const SimulationCheckpointFile&) =
+        delete;
+
+    // Queues the frame for writing and returns immediately.
+    void write_frame_async(int64_t frame, nlohmann::json state);
+    // Returns false when the frame could not be written.
+    bool write_frame(int64_t frame, const nlohmann::json& state);
+
+    bool read_frame(int64_t frame, nlohmann::json& state);
+
+    bool has_frame(int64_t frame);
+    std::vector<int64_t> frames();
+
+    // Blocks until every queued frame is written. Returns false when a
+    // write failed since the previous flush; failed frames are logged and
+    // left out of the file.
+    bool flush();
+
+    const std::filesystem::path& path() const
+    {
+        return path_;
+    }
+
+   private:
+    struct ChunkLocation {
+        std::streamoff offset;
+        uint64_t size;
+    };
+
+    // End of the last complete chunk
+    std::streamoff scan_index();
+    bool append_chunk(int64_t frame, const std::vector<uint8_t>& payload);
+    void writer_loop();
+
+    std::filesystem::path path_;
+    std::ofstream out_;
+
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<std::pair<int64_t, nlohmann::json>> queue_;
+    bool writing_ = false;
+    bool write_failed_ = false;
+    bool stopping_ = false;
+    std::map<int64_t, ChunkLocation> index_;
+
+    std::thread writer_;
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -38,6 +38,9 @@ struct NODES_CORE_API NodeSocket {
         entt::meta_any value;
         entt::meta_any min;
         entt::meta_any max;
+        // Stamp of the last write to `value`, see mark_default_changed(). 0
+        // until the first one.
+        uint64_t version = 0;
     } dataField;
 
     explicit NodeSocket(int id = 0)
@@ -52,7 +55,7 @@ struct NODES_CORE_API NodeSocket {
     bool is_placeholder() const;
 
     void Serialize(nlohmann::json& value);
-    void DeserializeInfo(nlohmann::json& value);
+    void DeserializeInfo(const nlohmann::json& value);
     void DeserializeValue(const nlohmann::json& value);
 
     /** Utility to access the value of the socket. */
@@ -68,8 +71,14 @@ struct NODES_CORE_API NodeSocket {
     void set_default_value(const T& value)
     {
         dataField.value = entt::meta_any{ value };
+        mark_default_changed();
     }
 
+    // Gives the default value a new version. Executors copy a default only
+    // when its version moved, so code writing through default_value_typed<T&>()
+    // or dataField.value directly has to call this afterwards.
+    void mark_default_changed();
+
     friend bool operator==(const NodeSocket& lhs, const NodeSocket& rhs)
     {
         return strcmp(lhs.identifier, rhs.identifier) == 0 &&
@@ -88,6 +97,8 @@ struct NODES_CORE_API NodeSocket {
     // For materialX tree adaption, storing extra information.
     mutable entt::meta_any storage;
     bool optional = false;
+    // Evaluated on request, see SocketDeclarationBuilder::lazy()
+    bool lazy = false;
 };
 
 template<typename T>
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+
+#include "api.hpp"
+#include "entt/meta/meta.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+// Hashes runtime values, so the executor can tell that a pure node sees the
+// same inputs as in its previous run. Types are looked up by their entt id;
+// builtin scalars, strings and the float vectors are registered already.
+using ValueHasher = std::function<size_t(const void* value)>;
+
+NODES_CORE_API void register_value_hasher(
+    entt::id_type type,
+    ValueHasher hasher);
+
+NODES_CORE_API const ValueHasher* find_value_hasher(entt::id_type type);
+
+// nullopt when the value is empty or its type has no hasher.
+NODES_CORE_API std::optional<size_t> hash_value(const entt::meta_any& value);
+
+NODES_CORE_API size_t hash_combine(size_t seed, size_t value);
+
+template<typename T, typename Hash>
+void register_value_hasher(Hash hash)
+{
+    register_value_hasher(
+        entt::type_hash<T>().value(), [hash](const void* value) {
+            return static_cast<size_t>(hash(*static_cast<const T*>(value)));
+        });
+}
+
+// For types std::hash supports.
+template<typename T>
+void register_value_hasher()
+{
+    register_value_hasher<T>(std::hash<T>{});
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <functional>
+
+#include "api.hpp"
+#include "entt/meta/meta.hpp"
+#include "io/json.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+// Converts runtime values (socket values, node storage) from and to json. Types
+// are looked up by their entt id, so a registration survives meta resets.
+struct ValueSerializer {
+    std::function<void(const entt::meta_any& value, nlohmann::json& json)>
+        serialize;
+    std::function<void(const nlohmann::json& json, entt::meta_any& value)>
+        deserialize;
+};
+
+NODES_CORE_API void register_value_serializer(
+    entt::id_type type,
+    ValueSerializer serializer);
+
+NODES_CORE_API const ValueSerializer* find_value_serializer(
+    entt::id_type type);
+
+// Both return false when the value is empty or its type is not registered.
+NODES_CORE_API bool serialize_value(
+    const entt::meta_any& value,
+    nlohmann::json& json);
+NODES_CORE_API bool deserialize_value(
+    entt::id_type type,
+    const nlohmann::json& json,
+    entt::meta_any& value);
+
+// For types nlohmann::json already knows how to convert.
+template<typename T>
+void register_value_serializer()
+{
+    register_value_serializer(
+        entt::type_hash<T>().value(),
+        ValueSerializer{
+            [](const entt::meta_any& value, nlohmann::json& json) {
+                json = value.cast<const T&>();
+            },
+            [](const nlohmann::json& json, entt::meta_any& value) {
+                value = entt::meta_any{ get_entt_ctx(), json.get<T>() };
+            } });
+}
+
+template<typename T, typename ToJson, typename FromJson>
+void register_value_serializer(ToJson to_json, FromJson from_json)
+{
+    register_value_serializer(
+        entt::type_hash<T>().value(),
+        ValueSerializer{
+            [to_json](const entt::meta_any& value, nlohmann::json& json) {
+                to_json(value.cast<const T&>(), json);
+            },
+            [from_json](const nlohmann::json& json, entt::meta_any& value) {
+                T typed{};
+                from_json(json, typed);
+                value = entt::meta_any{ get_entt_ctx(), std::move(typed) };
+            } });
+}
+
+// For node storage types providing serialize()/deserialize(), the same pair
+// ExeParams::set_storage uses for storage_info.
+template<typename T>
+void register_storage_serializer()
+{
+    register_value_serializer<T>(
+        [](const T& storage, nlohmann::json& json) {
+            json = storage.serialize();
+        },
+        [](const nlohmann::json& json, T& storage) {
+            storage.deserialize(json.get<std::string>());
+        });
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
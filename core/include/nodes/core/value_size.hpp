@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include "api.hpp"
+#include "entt/meta/meta.hpp"
+#include "io/json.hpp"
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+struct Node;
+struct NodeSocket;
+
+// Estimates the bytes a runtime value retains, including what it owns on the
+// heap. Types without an estimator count as sizeof(T), which is exact for
+// flat types only; register one for containers and plugin types holding
+// buffers.
+using ValueSizeEstimator = std::function<size_t(const void* value)>;
+
+NODES_CORE_API void register_value_size_estimator(
+    entt::id_type type,
+    ValueSizeEstimator estimator);
+
+NODES_CORE_API const ValueSizeEstimator* find_value_size_estimator(
+    entt::id_type type);
+
+// 0 for an empty value.
+NODES_CORE_API size_t estimate_value_size(const entt::meta_any& value);
+
+template<typename T, typename Estimate>
+void register_value_size_estimator(Estimate estimate)
+{
+    register_value_size_estimator(
+        entt::type_hash<T>().value(), [estimate](const void* value) {
+            return static_cast<size_t>(
+                estimate(*static_cast<const T*>(value)));
+        });
+}
+
+// Deep size of a typed value, for use inside estimators of aggregates.
+template<typename T>
+size_t estimate_size_of(const T& value)
+{
+    auto estimator = find_value_size_estimator(entt::type_hash<T>().value());
+    if (estimator)
+        return (*estimator)(&value);
+    return sizeof(T);
+}
+
+// For std::vector-like containers. Elements are deep-sized only when their
+// type has an estimator itself.
+template<typename Container>
+void register_container_size_estimator()
+{
+    using Element = typename Container::value_type;
+    register_value_size_estimator<Container>([](const Container& container) {
+        size_t bytes = sizeof(Container);
+        size_t reserved = container.size();
+        if constexpr (requires { container.capacity(); })
+            reserved = container.capacity();
+
+        auto element_type = entt::type_hash<Element>().value();
+        if (!find_value_size_estimator(element_type)) {
+            return bytes + reserved * sizeof(Element);
+        }
+        bytes += (reserved - container.size()) * sizeof(Element);
+        for (auto& element : container) {
+            bytes += estimate_size_of(element);
+        }
+        return bytes;
+    });
+}
+
+// Bytes retained by an executor, see NodeTreeExecutor::memory_report().
+struct NODES_CORE_API MemoryReport {
+    struct Usage {
+        size_t bytes = 0;
+        size_t values = 0;
+
+        void add(size_t value_bytes)
+        {
+            bytes += value_bytes;
+            values++;
+        }
+    };
+
+    Usage total;
+    // Where the values live: "current" and "persistent" socket states,
+    // "frame_cache", "node_storage" and "func_storage".
+    std::map<std::string, Usage> per_category;
+    std::map<std::string, Usage> per_type;
+    std::map<Node*, Usage> per_node;
+    std::map<NodeSocket*, Usage> per_socket;
+
+    void add(
+        const entt::meta_any& value,
+        const char* category,
+        Node* node = nullptr,
+        NodeSocket* socket = nullptr);
+    // Adds the report of a nested executor, e.g. of a group. Its total is
+    // charged to `node`; its own nodes and sockets belong to another tree
+    // and are not listed.
+    void merge(const MemoryReport& other, Node* node);
+
+    // Nodes and sockets are keyed by ID, nodes are sorted by bytes.
+    nlohmann::json to_json() const;
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nodes/core/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+/**
+ * class WorkerPool
+ * The threads data-parallel work of the core runs on, one fewer than the
+ * hardware threads. The calling thread always takes part, so a
+ * parallel_for() nested in another one completes even with every worker
+ * busy, and nesting never adds threads.
+ */
+class NODES_CORE_API WorkerPool {
+   public:
+    static WorkerPool& instance();
+
+    explicit WorkerPool(size_t thread_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls body(i) for every i below `count` on this thread and on idle
+    // workers, at most `max_threads` at once, 0 for no limit. Returns once
+    // all calls returned, rethrowing the first exception thrown.
+    void parallel_for(
+        size_t count,
+        const std::function<void(size_t)>& body,
+        size_t max_threads = 0);
+
+    size_t thread_count() const;
+
+   private:
+    void worker_loop();
+
+    std::mutex mutex;
+    std::condition_variable task_added;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::thread> threads;
+    bool stopping = false;
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
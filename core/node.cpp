@@ -4,6 +4,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include <cstdio>
+
 #include "nodes/core/api.h"
 #include "nodes/core/io/json.hpp"
 #include "nodes/core/node_link.hpp"
@@ -66,6 +68,37 @@ NodeTypeInfo& NodeTypeInfo::set_always_dirty(bool always_dirty)
     return *this;
 }
 
+NodeTypeInfo& NodeTypeInfo::set_payload_dependencies(
+    std::vector<std::string> fields)
+{
+    this->payload_dependencies = std::move(fields);
+    return *this;
+}
+
+NodeTypeInfo& NodeTypeInfo::set_pure(bool pure)
+{
+    this->PURE = pure;
+    return *this;
+}
+
+NodeTypeInfo& NodeTypeInfo::set_thread_safe(bool thread_safe)
+{
+    this->THREAD_SAFE = thread_safe;
+    return *this;
+}
+
+NodeTypeInfo& NodeTypeInfo::set_cost(float cost)
+{
+    this->COST = cost;
+    return *this;
+}
+
+NodeTypeInfo& NodeTypeInfo::set_inplace_inputs(std::vector<std::string> inputs)
+{
+    this->inplace_inputs = std::move(inputs);
+    return *this;
+}
+
 void NodeTypeInfo::reset_declaration()
 {
     static_declaration = NodeDeclaration();
@@ -421,6 +454,7 @@ NodeSocket* Node::add_socket(
     register_socket_to_node(socket, in_out);
 
     tree_->sockets.emplace_back(socket);
+    tree_->bump_structure_version();
     return socket;
 }
 
@@ -535,6 +569,7 @@ void Node::remove_outdated_socket(NodeSocket* socket, PinKind kind)
                     tree_->sockets.end(),
                     [socket](auto&& ptr) { return socket == ptr.get(); });
                 tree_->sockets.erase(out_dated_socket);
+                tree_->bump_structure_version();
             }
             break;
         case PinKind::Input:
@@ -546,6 +581,7 @@ void Node::remove_outdated_socket(NodeSocket* socket, PinKind kind)
                     tree_->sockets.end(),
                     [socket](auto&& ptr) { return socket == ptr.get(); });
                 tree_->sockets.erase(out_dated_socket);
+                tree_->bump_structure_version();
             }
             break;
         default: break;
@@ -679,21 +715,129 @@ bool NodeGroup::is_node_group()
     return true;
 }
 
+std::string sub_tree_content_key(const std::string& serialized)
+{
+    // FNV-1a, stable across runs unlike the pointer values that were used
+    // before. NodeGroup::serialize() resolves the rare collision.
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : serialized) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    char buffer[17];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%016llx",
+        static_cast<unsigned long long>(hash));
+    return std::string("sub_tree_") + buffer;
+}
+
+NodeTree* NodeGroup::get_sub_tree()
+{
+    materialize_sub_tree();
+    return sub_tree.get();
+}
+
+bool NodeGroup::is_sub_tree_materialized() const
+{
+    return !sub_tree_pending_.load(std::memory_order_acquire);
+}
+
+void NodeGroup::set_pending_sub_tree(std::shared_ptr<SubTreeSource> source)
+{
+    std::lock_guard lock(sub_tree_mutex_);
+    pending_sub_tree_ = std::move(source);
+    sub_tree_pending_.store(true, std::memory_order_release);
+}
+
+void NodeGroup::materialize_sub_tree()
+{
+    if (!sub_tree_pending_.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard lock(sub_tree_mutex_);
+    if (!sub_tree_pending_.load(std::memory_order_relaxed))
+        return;
+
+    // Only the parse is shared, every group gets its own nodes.
+    std::shared_ptr<const nlohmann::json> plan;
+    {
+        auto& source = *pending_sub_tree_;
+        std::lock_guard source_lock(source.mutex);
+        if (!source.plan) {
+            auto parsed = std::make_shared<nlohmann::json>(
+                nlohmann::json::parse(source.serialized));
+            source.plan = std::move(parsed);
+        }
+        plan = source.plan;
+    }
+    sub_tree = std::make_shared<NodeTree>(tree_->get_descriptor());
+    sub_tree->deserialize(*plan);
+    pending_sub_tree_.reset();
+    bind_sub_tree_interface();
+
+    sub_tree_pending_.store(false, std::memory_order_release);
+}
+
+void NodeGroup::bind_sub_tree_interface()
+{
+    group_in = sub_tree->find_node(NODE_GROUP_IN_IDENTIFIER);
+    group_out = sub_tree->find_node(NODE_GROUP_OUT_IDENTIFIER);
+
+    sub_tree->parent_node = this;
+
+    input_mapping_from_interface_to_internal.clear();
+    output_mapping_from_interface_to_internal.clear();
+
+    for (int i = 0; i < inputs.size(); ++i) {
+        auto input = inputs[i];
+        if (input->is_placeholder())
+            continue;
+
+        input_mapping_from_interface_to_internal[input] =
+            group_in->get_outputs()[i];
+    }
+
+    for (int i = 0; i < outputs.size(); ++i) {
+        auto output = outputs[i];
+        if (output->is_placeholder())
+            continue;
+        output_mapping_from_interface_to_internal[output] =
+            group_out->get_inputs()[i];
+    }
+}
+
 void NodeGroup::serialize(nlohmann::json& value)
 {
     Node::serialize(value);
-    std::string sub_tree_key =
-        "sub_tree_" +
-        std::to_string(reinterpret_cast<uintptr_t>(sub_tree.get())) + "_ptr";
-
-    auto& node = value[std::to_string(ID.Get())];
-    node["subtree"] = sub_tree_key;
 
-    auto& sub_tree_json_location = value["sub_trees"][sub_tree_key];
+    std::string serialized;
+    {
+        // A pending subtree is written back as-is, without decoding it.
+        std::lock_guard lock(sub_tree_mutex_);
+        if (sub_tree_pending_.load(std::memory_order_relaxed))
+            serialized = pending_sub_tree_->serialized;
+        else
+            serialized = sub_tree->serialize();
+    }
+    auto& sub_trees = value["sub_trees"];
 
-    if (!value.contains(sub_tree_json_location)) {
-        sub_tree_json_location = sub_tree->serialize();
+    // Identical subtrees are written once. A different subtree whose key
+    // collides gets a suffixed key instead of being dropped.
+    std::string base_key = sub_tree_content_key(serialized);
+    std::string sub_tree_key = base_key;
+    for (int i = 1; sub_trees.contains(sub_tree_key); ++i) {
+        if (sub_trees[sub_tree_key].get_ref<const std::string&>() ==
+            serialized)
+            break;
+        sub_tree_key = base_key + "_" + std::to_string(i);
     }
+    if (!sub_trees.contains(sub_tree_key))
+        sub_trees[sub_tree_key] = std::move(serialized);
+
+    auto& node = value[std::to_string(ID.Get())];
+    node["subtree"] = sub_tree_key;
 }
 
 NodeSocket* NodeGroup::group_add_socket(
@@ -723,6 +867,7 @@ void NodeGroup::group_remove_socket(
     assert(
         group_identifier == OutsideInputsPH ||
         group_identifier == OutsideOutputsPH);
+    materialize_sub_tree();
 
     auto socket = find_socket(identifier, in_out);
 
@@ -778,27 +923,13 @@ void NodeGroup::group_remove_socket(
 void NodeGroup::deserialize(const nlohmann::json& node_json)
 {
     Node::deserialize(node_json);
-    group_in = sub_tree->find_node(NODE_GROUP_IN_IDENTIFIER);
-    group_out = sub_tree->find_node(NODE_GROUP_OUT_IDENTIFIER);
-
-    sub_tree->parent_node = this;
-
-    for (int i = 0; i < inputs.size(); ++i) {
-        auto input = inputs[i];
-        if (input->is_placeholder())
-            continue;
 
-        input_mapping_from_interface_to_internal[input] =
-            group_in->get_outputs()[i];
-    }
+    // The interface sockets are built above; the internal mapping waits for
+    // the subtree to be decoded.
+    if (sub_tree_pending_.load(std::memory_order_acquire))
+        return;
 
-    for (int i = 0; i < outputs.size(); ++i) {
-        auto output = outputs[i];
-        if (output->is_placeholder())
-            continue;
-        output_mapping_from_interface_to_internal[output] =
-            group_out->get_inputs()[i];
-    }
+    bind_sub_tree_interface();
 }
 
 std::pair<NodeSocket*, NodeSocket*> NodeGroup::node_group_add_input_socket(
@@ -806,6 +937,7 @@ std::pair<NodeSocket*, NodeSocket*> NodeGroup::node_group_add_input_socket(
     const char* identifier,
     const char* name)
 {
+    materialize_sub_tree();
     auto added_outside_socket = Node::group_add_socket(
         OutsideInputsPH,
         type_name,
@@ -830,6 +962,7 @@ std::pair<NodeSocket*, NodeSocket*> NodeGroup::node_group_add_output_socket(
     const char* identifier,
     const char* name)
 {
+    materialize_sub_tree();
     auto added_outside_socket = Node::group_add_socket(
         OutsideOutputsPH,
         type_name,
@@ -4,11 +4,56 @@
 #include "nodes/core/node_exec_eager.hpp"
 #include "nodes/core/node_link.hpp"
 #include "nodes/core/socket.hpp"
+#include "nodes/core/value_size.hpp"
 
 RUZINO_NAMESPACE_OPEN_SCOPE
 void ExeParams::set_error(const char* str) const
 {
-    node_.set_error(str);
+    if (error_)
+        *error_ = str;
+    else
+        node_.set_error(str);
+}
+
+void ExeParams::record_payload_read(const char* field) const
+{
+    if (executor) {
+        executor->track_global_payload_read(
+            const_cast<Node*>(&node_), field ? field : "");
+    }
+}
+
+void ExeParams::record_input_write(int index) const
+{
+    if (executor) {
+        executor->track_input_write(node_.get_inputs()[index]);
+    }
+}
+
+ExecutionQuality ExeParams::get_quality() const
+{
+    if (executor) {
+        executor->track_quality_read(const_cast<Node*>(&node_));
+    }
+    return quality;
+}
+
+void ExeParams::evaluate_if_lazy(int index) const
+{
+    if (lazy_inputs_.empty() || !lazy_inputs_[index]) {
+        return;
+    }
+    auto socket = lazy_inputs_[index];
+    lazy_inputs_[index] = nullptr;
+    if (executor) {
+        executor->evaluate_lazy_input(socket);
+    }
+}
+
+bool ExeParams::defer_output(int index, std::shared_ptr<PendingValue> value)
+{
+    return executor && executor->defer_output(
+                           const_cast<Node*>(&node_), index, std::move(value));
 }
 
 int ExeParams::get_input_index(const char* identifier) const
@@ -19,7 +64,13 @@ int ExeParams::get_input_index(const char* identifier) const
 std::vector<size_t> ExeParams::get_input_group_indices(
     const char* group_identifier) const
 {
-    return node_.find_socket_group_ids(group_identifier, PinKind::Input);
+    auto indices =
+        node_.find_socket_group_ids(group_identifier, PinKind::Input);
+    // A group is read as a whole, so its lazy members are all needed
+    for (auto index : indices) {
+        evaluate_if_lazy(static_cast<int>(index));
+    }
+    return indices;
 }
 std::vector<size_t> ExeParams::get_output_group_indices(
     const char* group_identifier) const
@@ -32,6 +83,11 @@ int ExeParams::get_output_index(const char* identifier)
     return node_.find_socket_id(identifier, PinKind::Output);
 }
 
+MemoryReport NodeTreeExecutor::memory_report() const
+{
+    return {};
+}
+
 std::unique_ptr<NodeTreeExecutor> create_executor(NodeTreeExecutorDesc& exec)
 {
     switch (exec.policy) {
@@ -1,63 +1,247 @@
 #include "nodes/core/node_exec_eager.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
 #include <set>
+#include <sstream>
+#include <utility>
 
 #include "entt/core/any.hpp"
 #include "entt/meta/resolve.hpp"
 #include "nodes/core/api.h"
+#include "nodes/core/diagnostics.hpp"
+#include "nodes/core/execution_recorder.hpp"
 #include "nodes/core/node_tree.hpp"
-#include "spdlog/spdlog.h"
+#include "nodes/core/value_hash.hpp"
+#include "nodes/core/value_size.hpp"
+#include "nodes/core/worker_pool.hpp"
 
 RUZINO_NAMESPACE_OPEN_SCOPE
 
-void EagerNodeTreeExecutor::mark_node_dirty(Node* node)
+// Zone pairs, groups and nodes with storage carry state from one execution
+// to the next, skipping them would leave it behind.
+static bool holds_state(Node* node)
 {
+    return node->storage || node->paired_node || node->is_node_group();
+}
+
+const char* dirty_cause_name(DirtyCause cause)
+{
+    switch (cause) {
+        case DirtyCause::NodeNotified: return "node notified";
+        case DirtyCause::SocketNotified: return "socket notified";
+        case DirtyCause::ExternalInput: return "external input changed";
+        case DirtyCause::UpstreamDirty: return "upstream dirty";
+        case DirtyCause::InputChanged: return "input value changed";
+        case DirtyCause::AlwaysDirty: return "ALWAYS_DIRTY";
+        case DirtyCause::TypeMismatch: return "cached value type mismatch";
+        case DirtyCause::StructureChanged: return "tree structure changed";
+        case DirtyCause::Restored: return "restored dirty state";
+        case DirtyCause::PayloadChanged: return "global payload changed";
+        case DirtyCause::DefaultChanged: return "default value changed";
+        case DirtyCause::QualityChanged: return "quality changed";
+    }
+    return "unknown";
+}
+
+void EagerNodeTreeExecutor::mark_node_dirty(
+    Node* node,
+    DirtyCause cause,
+    Node* source,
+    NodeSocket* socket)
+{
+    // Results kept per quality only hold while nothing but the quality
+    // changes. The others are passed on by nodes dirty for a cause of their
+    // own.
+    if (cause != DirtyCause::QualityChanged &&
+        cause != DirtyCause::UpstreamDirty &&
+        cause != DirtyCause::InputChanged)
+        quality_cache.clear();
+
     dirty_nodes.insert(node);
-    node_dirty_cache[node] = true;
+    auto& dirty = node_dirty_cache[node];
+    if (!dirty) {
+        counters.dirty_marks++;
+        record_dirty_event(cause, node, source, socket);
+    }
+    dirty = true;
 }
 
 void EagerNodeTreeExecutor::mark_socket_dirty(NodeSocket* socket)
 {
-    mark_node_dirty(socket->node);
+    mark_node_dirty(socket->node, DirtyCause::SocketNotified, nullptr, socket);
 }
 
 void EagerNodeTreeExecutor::notify_node_dirty(Node* node)
 {
+    invalidate_result_caches();
     mark_node_dirty(node);
 }
 
 void EagerNodeTreeExecutor::notify_socket_dirty(NodeSocket* socket)
 {
-    mark_node_dirty(socket->node);
+    // Hosts editing the default in place and notifying afterwards still get
+    // it copied.
+    if (socket->in_out == PinKind::Input && socket->dataField.value)
+        socket->mark_default_changed();
+    invalidate_result_caches();
+    mark_socket_dirty(socket);
     invalidate_cache_for_node(socket->node);
 
-    // Propagate dirty to all downstream nodes
-    std::vector<Node*> to_visit;
+    // Propagate dirty to all downstream nodes, along with who passed it on
+    std::vector<std::pair<Node*, Node*>> to_visit;
     for (auto* output : socket->node->get_outputs()) {
         for (auto* linked_socket : output->directly_linked_sockets) {
-            to_visit.push_back(linked_socket->node);
+            to_visit.emplace_back(linked_socket->node, socket->node);
         }
     }
 
     while (!to_visit.empty()) {
-        Node* current = to_visit.back();
+        auto [current, source] = to_visit.back();
         to_visit.pop_back();
 
         if (is_node_dirty(current)) {
             continue;  // Already marked
         }
 
-        mark_node_dirty(current);
+        mark_node_dirty(current, DirtyCause::UpstreamDirty, source);
         invalidate_cache_for_node(current);
 
         // Add downstream nodes
         for (auto* output : current->get_outputs()) {
             for (auto* linked_socket : output->directly_linked_sockets) {
+                to_visit.emplace_back(linked_socket->node, current);
+            }
+        }
+    }
+}
+
+void EagerNodeTreeExecutor::notify_global_payload_changed(
+    const std::vector<std::string>& fields)
+{
+    // Dirty nodes execute anyway, only cached results can go stale.
+    std::vector<Node*> dependents;
+    for (auto& [node, dirty] : node_dirty_cache) {
+        if (!dirty && depends_on_payload(node, fields))
+            dependents.push_back(node);
+    }
+    // Those always dirty included. Stepping to another frame changes the
+    // payload too, begin_run() tells it from an edit.
+    for (int i = 0; i < nodes_to_execute_count; ++i) {
+        if (depends_on_payload(nodes_to_execute[i], fields)) {
+            quality_cache.clear();
+            payload_changed_since_run = true;
+            break;
+        }
+    }
+    for (auto* node : dependents) {
+        propagate_dirty_downstream(node, nullptr, DirtyCause::PayloadChanged);
+    }
+}
+
+void EagerNodeTreeExecutor::track_global_payload_read(
+    Node* node,
+    const char* field)
+{
+    auto& reads = payload_reads[node];
+    if (std::find(reads.begin(), reads.end(), field) == reads.end())
+        reads.emplace_back(field);
+}
+
+void EagerNodeTreeExecutor::set_quality(ExecutionQuality quality)
+{
+    if (quality == this->quality) {
+        return;
+    }
+    this->quality = quality;
+    // Cached frames are of the previous quality
+    frame_cache.clear();
+
+    // Dirty nodes execute anyway, only cached results can go stale.
+    std::vector<Node*> readers;
+    for (auto* node : quality_readers) {
+        if (!is_node_dirty(node))
+            readers.push_back(node);
+    }
+    for (auto* node : readers) {
+        propagate_dirty_downstream(node, nullptr, DirtyCause::QualityChanged);
+    }
+}
+
+void EagerNodeTreeExecutor::track_quality_read(Node* node)
+{
+    quality_readers.insert(node);
+}
+
+void EagerNodeTreeExecutor::track_input_write(NodeSocket* socket)
+{
+    // A default changed in place is copied in again before the next run
+    auto index = index_cache.find(socket);
+    if (index != index_cache.end())
+        input_states[index->second].default_version = 0;
+}
+
+void EagerNodeTreeExecutor::evaluate_lazy_input(NodeSocket* socket)
+{
+    // The deferred nodes feeding the socket, except those behind further lazy
+    // inputs, which wait for their own request.
+    std::set<Node*> cone;
+    std::vector<Node*> to_visit;
+    for (auto* linked_socket : socket->directly_linked_sockets) {
+        to_visit.push_back(linked_socket->node);
+    }
+    while (!to_visit.empty()) {
+        auto node = to_visit.back();
+        to_visit.pop_back();
+        if (!deferred_nodes.count(node) ||
+            evaluated_deferred_nodes.count(node) || !cone.insert(node).second)
+            continue;
+        for (auto* input : node->get_inputs()) {
+            if (input->lazy)
+                continue;
+            for (auto* linked_socket : input->directly_linked_sockets) {
                 to_visit.push_back(linked_socket->node);
             }
         }
     }
+
+    for (int i = 0; i < nodes_to_execute_count; ++i) {
+        auto node = nodes_to_execute[i];
+        if (cone.count(node)) {
+            evaluated_deferred_nodes.insert(node);
+            run_node(executing_tree, node);
+            // The reading node cannot go on without it
+            if (pending_outputs.count(node))
+                complete_pending(executing_tree, node);
+        }
+    }
+}
+
+bool EagerNodeTreeExecutor::depends_on_payload(
+    Node* node,
+    const std::vector<std::string>& fields) const
+{
+    auto affected = [&fields](const std::string& dependency) {
+        if (fields.empty() || dependency.empty())
+            return true;
+        return std::find(fields.begin(), fields.end(), dependency) !=
+               fields.end();
+    };
+
+    for (auto& dependency : node->typeinfo->payload_dependencies) {
+        if (affected(dependency))
+            return true;
+    }
+    auto reads = payload_reads.find(node);
+    if (reads != payload_reads.end()) {
+        for (auto& field : reads->second) {
+            if (affected(field))
+                return true;
+        }
+    }
+    return false;
 }
 
 entt::meta_any* EagerNodeTreeExecutor::get_socket_value(NodeSocket* socket)
@@ -69,6 +253,11 @@ void EagerNodeTreeExecutor::mark_tree_structure_changed()
 {
     // When tree structure changes, invalidate index cache and mark all as dirty
     // This forces a full recompilation
+    finish_streaming_nodes(false);
+    run_in_progress = false;
+    pending_outputs.clear();
+    postponed_nodes.clear();
+    waiting_nodes.clear();
     index_cache.clear();
     for (auto& state : input_states) {
         state.is_cached = false;
@@ -78,9 +267,17 @@ void EagerNodeTreeExecutor::mark_tree_structure_changed()
     }
     node_dirty_cache.clear();
     dirty_nodes.clear();
+    payload_reads.clear();
+    pure_input_hashes.clear();
 
     persistent_input_cache.clear();
     persistent_output_cache.clear();
+
+    invalidate_result_caches();
+
+    node_dirty_event.clear();
+    record_dirty_event(DirtyCause::StructureChanged, nullptr);
+    structure_changed_event = dirty_event_count;
 }
 
 bool EagerNodeTreeExecutor::is_node_dirty(Node* node) const
@@ -92,6 +289,7 @@ bool EagerNodeTreeExecutor::is_node_dirty(Node* node) const
 void EagerNodeTreeExecutor::mark_node_clean(Node* node)
 {
     node_dirty_cache[node] = false;
+    node_dirty_event.erase(node);
 }
 
 void EagerNodeTreeExecutor::invalidate_cache_for_node(Node* node)
@@ -122,20 +320,24 @@ void EagerNodeTreeExecutor::invalidate_cache_for_node(Node* node)
 
 void EagerNodeTreeExecutor::propagate_dirty_downstream(
     Node* node,
-    NodeTree* tree)
+    NodeTree* tree,
+    DirtyCause cause)
 {
-    std::vector<Node*> to_visit;
-    to_visit.push_back(node);
+    std::vector<std::pair<Node*, Node*>> to_visit;
+    to_visit.emplace_back(node, nullptr);
 
     while (!to_visit.empty()) {
-        Node* current = to_visit.back();
+        auto [current, source] = to_visit.back();
         to_visit.pop_back();
 
         if (is_node_dirty(current)) {
             continue;  // Already processed
         }
 
-        mark_node_dirty(current);
+        if (source)
+            mark_node_dirty(current, DirtyCause::UpstreamDirty, source);
+        else
+            mark_node_dirty(current, cause);
         invalidate_cache_for_node(current);
 
         // Propagate to downstream nodes
@@ -143,17 +345,38 @@ void EagerNodeTreeExecutor::propagate_dirty_downstream(
             for (auto* linked_socket : output->directly_linked_sockets) {
                 Node* downstream = linked_socket->node;
                 if (!is_node_dirty(downstream)) {
-                    to_visit.push_back(downstream);
+                    to_visit.emplace_back(downstream, current);
                 }
             }
         }
     }
 }
 
+void EagerNodeTreeExecutor::detect_default_changes(NodeTree* tree)
+{
+    for (auto* input : input_of_nodes_to_execute) {
+        if (!input->directly_linked_sockets.empty() ||
+            !input->dataField.value || default_overrides.count(input))
+            continue;
+        // Inputs that never held their default are dirty for other reasons
+        auto& state = input_states[index_cache[input]];
+        if (!state.default_version ||
+            state.default_version == input->dataField.version)
+            continue;
+        if (is_node_dirty(input->node))
+            continue;
+        invalidate_result_caches();
+        propagate_dirty_downstream(
+            input->node, tree, DirtyCause::DefaultChanged);
+    }
+}
+
 void EagerNodeTreeExecutor::collect_required_upstream(Node* node)
 {
     // Mark upstream nodes as required
     for (auto* input : node->get_inputs()) {
+        if (input->lazy)
+            continue;
         for (auto* linked_socket : input->directly_linked_sockets) {
             Node* upstream = linked_socket->node;
             if (!upstream->REQUIRED) {
@@ -164,6 +387,30 @@ void EagerNodeTreeExecutor::collect_required_upstream(Node* node)
     }
 }
 
+void EagerNodeTreeExecutor::collect_deferred_upstream(Node* node)
+{
+    std::vector<Node*> to_visit;
+    for (auto* input : node->get_inputs()) {
+        if (!input->lazy)
+            continue;
+        for (auto* linked_socket : input->directly_linked_sockets) {
+            to_visit.push_back(linked_socket->node);
+        }
+    }
+
+    while (!to_visit.empty()) {
+        auto current = to_visit.back();
+        to_visit.pop_back();
+        if (current->REQUIRED || !deferred_nodes.insert(current).second)
+            continue;
+        for (auto* input : current->get_inputs()) {
+            for (auto* linked_socket : input->directly_linked_sockets) {
+                to_visit.push_back(linked_socket->node);
+            }
+        }
+    }
+}
+
 ExeParams EagerNodeTreeExecutor::prepare_params(NodeTree* tree, Node* node)
 {
     node->MISSING_INPUT = false;
@@ -182,11 +429,27 @@ ExeParams EagerNodeTreeExecutor::prepare_params(NodeTree* tree, Node* node)
         }
         else if (
             input->directly_linked_sockets.empty() && input->dataField.value) {
-            auto type = input_states[index_cache[input]].value.type();
-            auto value = input->dataField.value;
-            // Has default value
-            input_states[index_cache[input]].value = value;
+            // Has default value, copied again only once it was written
+            auto& state = input_states[index_cache[input]];
+            auto version = input->dataField.version;
+            auto override = default_overrides.find(input);
+            if (override != default_overrides.end()) {
+                state.value = override->second;
+                state.default_version = 0;
+                counters.defaults_copied++;
+            }
+            else if (!version || state.default_version != version) {
+                state.value = input->dataField.value;
+                state.default_version = version;
+                counters.defaults_copied++;
+            }
+            input_ptr = &state.value;
+        }
+        else if (input->lazy && !input->directly_linked_sockets.empty()) {
+            // Forwarded here once the node reads it
             input_ptr = &input_states[index_cache[input]].value;
+            params.lazy_inputs_.resize(node->get_inputs().size());
+            params.lazy_inputs_[params.inputs_.size()] = input;
         }
         else if (input->optional) {
             input_ptr = nullptr;
@@ -206,8 +469,9 @@ ExeParams EagerNodeTreeExecutor::prepare_params(NodeTree* tree, Node* node)
         params.outputs_.push_back(output_ptr);
     }
     params.executor = this;
+    params.quality = quality;
     if (node->is_node_group())
-        params.subtree = static_cast<NodeGroup*>(node)->sub_tree.get();
+        params.subtree = static_cast<NodeGroup*>(node)->get_sub_tree();
     return params;
 }
 
@@ -219,11 +483,19 @@ bool EagerNodeTreeExecutor::execute_node(NodeTree* tree, Node* node)
     }
 
     ExeParams params = prepare_params(tree, node);
+    // The result comes from the body, which only runs from here
+    if (foreach_zones.count(node)) {
+        if (!run_foreach_zone(node, params))
+            return false;
+        node->execution_failed = {};
+        return true;
+    }
     if (node->MISSING_INPUT) {
         // Surface which required inputs are missing -- this is the single most
         // common cause of a node silently not cooking (and, in a simulation
         // zone, of a downstream crash when the feedback storage stays empty).
-        std::string missing_names;
+        NodeSocket* first_missing = nullptr;
+        uint64_t missing_count = 0;
         for (auto* input : node->get_inputs()) {
             if (input->is_placeholder())
                 continue;
@@ -231,26 +503,123 @@ bool EagerNodeTreeExecutor::execute_node(NodeTree* tree, Node* node)
                 continue;
             if (input->directly_linked_sockets.empty() &&
                 !input->dataField.value) {
-                if (!missing_names.empty())
-                    missing_names += ",";
-                missing_names += std::string(input->ui_name);
+                if (!first_missing)
+                    first_missing = input;
+                missing_count++;
             }
         }
-        spdlog::warn(
-            "[exec] node '{}' skipped: missing required input [{}]",
-            std::string(node->typeinfo->id_name),
-            missing_names);
+        diagnose<DiagnosticCode::MissingInput>(
+            tree,
+            node->ID.Get(),
+            first_missing ? first_missing->ID.Get() : 0,
+            missing_count);
+        return false;
+    }
+    // Their state lives on the nodes, which a fork shares with its parent
+    if (fork_parent && holds_state(node)) {
+        node->execution_failed = "Nodes holding state cannot run in a fork";
         return false;
     }
     auto typeinfo = node->typeinfo;
-    if (!typeinfo->node_execute(params)) {
+
+    // A pure node seeing the inputs of its last run would produce the
+    // outputs it still holds, unless it saw another quality.
+    std::optional<size_t> input_hash;
+    if (typeinfo->PURE && !always_dirty(node) &&
+        !quality_readers.contains(node)) {
+        input_hash = hash_pure_inputs(node, params);
+        if (input_hash && has_pure_result(node, *input_hash)) {
+            reused_pure_result = true;
+            node->execution_failed = {};
+            return true;
+        }
+    }
+
+    // Only the reads of this execution count from now on. Cleared in place,
+    // so a node reading the same fields every run does not allocate.
+    auto reads = payload_reads.find(node);
+    if (reads != payload_reads.end())
+        reads->second.clear();
+    quality_readers.erase(node);
+    if (produces_streams(node)) {
+        if (mixed_stream_producers.count(node)) {
+            node->execution_failed =
+                "A node producing streams can only have stream outputs";
+            return false;
+        }
+        start_streaming_node(node, params);
+        pure_input_hashes.erase(node);
+        node->execution_failed = {};
+        return true;
+    }
+    bool executed = typeinfo->node_execute(params);
+    if (fork_parent && node->storage) {
+        // Created by this execution, the parent would find it
+        node->storage = {};
+        node->execution_failed = "Nodes holding state cannot run in a fork";
+        return false;
+    }
+    for (auto& name : typeinfo->inplace_inputs) {
+        if (auto input = node->get_input_socket(name.c_str()))
+            track_input_write(input);
+    }
+    if (!executed) {
+        pure_input_hashes.erase(node);
         node->execution_failed = "Execution failed";
         return false;
     }
+    if (input_hash)
+        pure_input_hashes[node] = *input_hash;
+    else
+        pure_input_hashes.erase(node);
     node->execution_failed = {};
     return true;
 }
 
+std::optional<size_t> EagerNodeTreeExecutor::hash_pure_inputs(
+    Node* node,
+    const ExeParams& params) const
+{
+    // Lazy inputs not evaluated yet hold last run's values.
+    for (auto* lazy_input : params.lazy_inputs_) {
+        if (lazy_input)
+            return std::nullopt;
+    }
+
+    size_t seed = 0;
+    for (auto* input : params.inputs_) {
+        if (!input) {
+            seed = hash_combine(seed, 0);
+            continue;
+        }
+        auto hash = hash_value(*input);
+        if (!hash)
+            return std::nullopt;
+        seed = hash_combine(seed, *hash);
+    }
+
+    if (depends_on_payload(node, {})) {
+        auto hash = hash_value(global_payload);
+        if (!hash)
+            return std::nullopt;
+        seed = hash_combine(seed, *hash);
+    }
+    return seed;
+}
+
+bool EagerNodeTreeExecutor::has_pure_result(Node* node, size_t input_hash) const
+{
+    auto it = pure_input_hashes.find(node);
+    if (it == pure_input_hashes.end() || it->second != input_hash)
+        return false;
+    for (auto* output : node->get_outputs()) {
+        auto index = index_cache.find(output);
+        if (index == index_cache.end() || !output_states[index->second].value)
+            return false;
+    }
+    return true;
+}
+
 void EagerNodeTreeExecutor::forward_output_to_input(Node* node)
 {
     for (auto&& output : node->get_outputs()) {
@@ -300,13 +669,16 @@ void EagerNodeTreeExecutor::forward_output_to_input(Node* node)
                     else if (
                         input_state.value.type() &&
                         input_state.value.type() != value_to_forward.type()) {
-                        auto unequal =
-                            input_state.value.type() != value_to_forward.type();
+                        // The message stays constant so reassigning it does
+                        // not allocate; the types go to the diagnostics.
                         directly_linked_input_socket->node->execution_failed =
-                            "Type mismatch input, from type " +
-                            std::string(value_to_forward.type().info().name()) +
-                            " to type " +
-                            std::string(input_state.value.type().info().name());
+                            "Type mismatch input";
+                        diagnose<DiagnosticCode::InputTypeMismatch>(
+                            executing_tree,
+                            directly_linked_input_socket->node->ID.Get(),
+                            directly_linked_input_socket->ID.Get(),
+                            value_to_forward.type().id(),
+                            input_state.value.type().id());
                         input_state.is_forwarded = false;
                     }
                     else {
@@ -327,17 +699,25 @@ void EagerNodeTreeExecutor::forward_output_to_input(Node* node)
                                 (input_state.value != value_to_forward);
                         }
 
-                        // Always copy to preserve cache validity
-                        // Move is better in efficiency, but it breaks caching
-                        // because the output value becomes empty after the move
-                        input_state.value = value_to_forward;
+                        // Copy, don't move: moving breaks caching because
+                        // the output value becomes empty after the move. An
+                        // equal value is already in place.
+                        if (value_changed) {
+                            input_state.value = value_to_forward;
+                            counters.values_copied++;
+                        }
                         input_state.is_forwarded = true;
+                        input_state.default_version = 0;
 
                         // CRITICAL FIX: If value changed, mark downstream node
                         // as dirty so it will execute even if it was previously
                         // cached
                         if (value_changed) {
-                            mark_node_dirty(directly_linked_input_socket->node);
+                            mark_node_dirty(
+                                directly_linked_input_socket->node,
+                                DirtyCause::InputChanged,
+                                node,
+                                directly_linked_input_socket);
                             input_state.is_cached =
                                 false;  // Input is no longer cached since it
                                         // changed
@@ -434,6 +814,17 @@ void EagerNodeTreeExecutor::compile(NodeTree* tree, Node* required_node)
         }
     }
 
+    // Upstream of lazy inputs runs only when asked for, see
+    // evaluate_lazy_input(). It is marked required so it gets memory.
+    deferred_nodes.clear();
+    for (auto node : nodes_to_execute) {
+        if (node->REQUIRED)
+            collect_deferred_upstream(node);
+    }
+    for (auto node : deferred_nodes) {
+        node->REQUIRED = true;
+    }
+
     // Partition into required and not-required
     auto split = std::stable_partition(
         nodes_to_execute.begin(), nodes_to_execute.end(), [](Node* node) {
@@ -454,6 +845,301 @@ void EagerNodeTreeExecutor::compile(NodeTree* tree, Node* required_node)
             nodes_to_execute[i]->get_outputs().begin(),
             nodes_to_execute[i]->get_outputs().end());
     }
+
+    stream_producers.clear();
+    mixed_stream_producers.clear();
+    for (auto* output : output_of_nodes_to_execute) {
+        if (is_chunk_stream_type(output->type_info.id()))
+            stream_producers.insert(output->node);
+    }
+    for (auto* node : stream_producers) {
+        for (auto* output : node->get_outputs()) {
+            if (!output->is_placeholder() &&
+                !is_chunk_stream_type(output->type_info.id()))
+                mixed_stream_producers.insert(node);
+        }
+    }
+
+    compile_foreach_zones();
+}
+
+// Iterations run the body nodes directly, without the executor, so nodes
+// needing it are refused. Async outputs are waited for in the iteration.
+static std::string foreach_body_error(Node* node)
+{
+    auto& id_name = node->typeinfo->id_name;
+    if (id_name == FOREACH_BEGIN_IDENTIFIER ||
+        id_name == FOREACH_END_IDENTIFIER)
+        return "Nested for-each zones are not supported";
+    if (node->paired_node)
+        return node->ui_name + " is paired, zones cannot be nested";
+    for (auto* socket : node->get_inputs()) {
+        if (is_chunk_stream_type(socket->type_info.id()))
+            return node->ui_name + " reads a stream, not supported per element";
+    }
+    for (auto* socket : node->get_outputs()) {
+        if (is_chunk_stream_type(socket->type_info.id()))
+            return node->ui_name + " makes a stream, not supported per element";
+    }
+    return {};
+}
+
+void EagerNodeTreeExecutor::compile_foreach_zones()
+{
+    foreach_zones.clear();
+    zone_body_nodes.clear();
+
+    for (int i = 0; i < nodes_to_execute_count; ++i) {
+        auto end = nodes_to_execute[i];
+        auto begin = end->paired_node;
+        if (end->typeinfo->id_name != FOREACH_END_IDENTIFIER || !begin ||
+            begin->typeinfo->id_name != FOREACH_BEGIN_IDENTIFIER)
+            continue;
+
+        // The body is downstream of begin and upstream of end
+        auto walk = [](Node* from, bool downstream) {
+            std::set<Node*> reached;
+            std::vector<Node*> to_visit{ from };
+            while (!to_visit.empty()) {
+                auto node = to_visit.back();
+                to_visit.pop_back();
+                auto& sockets =
+                    downstream ? node->get_outputs() : node->get_inputs();
+                for (auto* socket : sockets) {
+                    for (auto* linked : socket->directly_linked_sockets) {
+                        if (reached.insert(linked->node).second)
+                            to_visit.push_back(linked->node);
+                    }
+                }
+            }
+            return reached;
+        };
+        auto after_begin = walk(begin, true);
+        auto before_end = walk(end, false);
+
+        ForEachZone zone;
+        zone.begin = begin;
+        for (auto* output : begin->get_outputs()) {
+            zone.slot_index.emplace(output, zone.slot_index.size());
+        }
+        for (int j = 0; j < nodes_to_execute_count; ++j) {
+            auto node = nodes_to_execute[j];
+            if (node == end || !after_begin.count(node) ||
+                !before_end.count(node))
+                continue;
+            zone.body.push_back(node);
+            // Node groups keep their executor in the node storage, which
+            // iterations would share, see also run_foreach_zone()
+            zone.parallel = zone.parallel && node->typeinfo->THREAD_SAFE &&
+                            !node->is_node_group();
+            if (zone.error.empty())
+                zone.error = foreach_body_error(node);
+            zone_body_nodes.insert(node);
+            for (auto* input : node->get_inputs()) {
+                zone.slot_index.emplace(input, zone.slot_index.size());
+            }
+            for (auto* output : node->get_outputs()) {
+                zone.slot_index.emplace(output, zone.slot_index.size());
+            }
+        }
+        // Body values exist per element only, nothing outside can read them
+        for (auto* node : zone.body) {
+            for (auto* output : node->get_outputs()) {
+                for (auto* linked : output->directly_linked_sockets) {
+                    if (zone.error.empty() && linked->node != end &&
+                        !zone.slot_index.count(linked))
+                        zone.error = node->ui_name +
+                                     " feeds a node outside the for-each zone";
+                }
+            }
+        }
+        foreach_zones[end] = std::move(zone);
+    }
+}
+
+const entt::meta_any* EagerNodeTreeExecutor::zone_outer_value(
+    NodeSocket* input) const
+{
+    auto index = index_cache.find(input);
+    if (index != index_cache.end() &&
+        input_states[index->second].is_forwarded) {
+        return &input_states[index->second].value;
+    }
+    if (input->directly_linked_sockets.empty()) {
+        return default_value(input);
+    }
+    return nullptr;
+}
+
+const entt::meta_any* EagerNodeTreeExecutor::default_value(
+    NodeSocket* input) const
+{
+    auto override = default_overrides.find(input);
+    if (override != default_overrides.end()) {
+        return &override->second;
+    }
+    return input->dataField.value ? &input->dataField.value : nullptr;
+}
+
+std::string EagerNodeTreeExecutor::run_foreach_iteration(
+    const ForEachZone& zone,
+    Node* end,
+    size_t index,
+    const entt::meta_any& element,
+    std::vector<entt::meta_any>& slot,
+    entt::meta_any& result)
+{
+    auto value_of = [&](NodeSocket* input) -> const entt::meta_any* {
+        if (!input->directly_linked_sockets.empty()) {
+            auto upstream = zone.slot_index.find(
+                input->directly_linked_sockets[0]);
+            if (upstream != zone.slot_index.end())
+                return &slot[upstream->second];
+        }
+        return zone_outer_value(input);
+    };
+
+    for (auto& value : slot) {
+        value = {};
+    }
+    slot[zone.slot_index.at(zone.begin->get_output_socket("Element"))] =
+        element;
+    slot[zone.slot_index.at(zone.begin->get_output_socket("Index"))] =
+        entt::meta_any{ get_entt_ctx(), static_cast<int>(index) };
+    // Captured values are the same for every element
+    auto captured_inputs =
+        zone.begin->find_socket_group_ids("Captured", PinKind::Input);
+    auto captured_outputs =
+        zone.begin->find_socket_group_ids("Captured", PinKind::Output);
+    for (size_t k = 0;
+         k < captured_inputs.size() && k < captured_outputs.size();
+         ++k) {
+        auto outer =
+            zone_outer_value(zone.begin->get_inputs()[captured_inputs[k]]);
+        if (outer)
+            slot[zone.slot_index.at(
+                zone.begin->get_outputs()[captured_outputs[k]])] = *outer;
+    }
+
+    for (auto* node : zone.body) {
+        ExeParams params{ *node, global_payload };
+        params.quality = quality;
+        for (auto* input : node->get_inputs()) {
+            if (input->is_placeholder()) {
+                continue;
+            }
+            auto& value = slot[zone.slot_index.at(input)];
+            if (auto source = value_of(input))
+                value = *source;
+            if (!value && !input->optional) {
+                return "Input " + std::string(input->ui_name) + " of " +
+                       node->ui_name + " missing";
+            }
+            params.inputs_.push_back(value ? &value : nullptr);
+        }
+        for (auto* output : node->get_outputs()) {
+            params.outputs_.push_back(&slot[zone.slot_index.at(output)]);
+        }
+        // Iterations must not call back into the executor, node groups only
+        // clone it
+        if (node->is_node_group()) {
+            params.executor = this;
+            params.subtree = static_cast<NodeGroup*>(node)->get_sub_tree();
+        }
+        std::string error;
+        params.error_ = &error;
+        if (!node->typeinfo->node_execute(params)) {
+            if (error.empty())
+                return node->ui_name + " failed";
+            return node->ui_name + ": " + error;
+        }
+    }
+
+    auto result_value = value_of(end->get_input_socket("Result"));
+    if (!result_value || !*result_value) {
+        return "No result";
+    }
+    result = *result_value;
+    return {};
+}
+
+bool EagerNodeTreeExecutor::run_foreach_zone(Node* end, ExeParams& params)
+{
+    auto& zone = foreach_zones.at(end);
+    if (!zone.error.empty()) {
+        end->execution_failed = zone.error;
+        return false;
+    }
+    auto elements_value =
+        zone_outer_value(zone.begin->get_input_socket("Elements"));
+    if (!elements_value || !*elements_value) {
+        end->execution_failed = "No elements";
+        return false;
+    }
+    auto& elements =
+        elements_value->cast<const std::vector<entt::meta_any>&>();
+
+    // The body may read any part of the payload, and the quality
+    track_global_payload_read(end, "");
+    track_quality_read(end);
+
+    std::vector<entt::meta_any> results(elements.size());
+    std::vector<std::string> failures(elements.size());
+    auto run_element = [&](size_t i) {
+        std::vector<entt::meta_any> slot(zone.slot_index.size());
+        try {
+            failures[i] = run_foreach_iteration(
+                zone, end, i, elements[i], slot, results[i]);
+        }
+        catch (const std::exception& e) {
+            failures[i] = e.what();
+        }
+    };
+
+    // Node storage is built on first use and shared by every element, so
+    // the first one runs alone and a body holding storage stays serial
+    bool parallel = zone.parallel;
+    size_t first = 0;
+    if (parallel && !elements.empty()) {
+        run_element(0);
+        first = 1;
+        parallel = std::none_of(
+            zone.body.begin(), zone.body.end(), [](Node* node) {
+                return static_cast<bool>(node->storage);
+            });
+    }
+    WorkerPool::instance().parallel_for(
+        elements.size() - first,
+        [&](size_t i) { run_element(first + i); },
+        parallel ? 0 : 1);
+    counters.foreach_iterations += elements.size();
+
+    for (size_t i = 0; i < failures.size(); ++i) {
+        if (!failures[i].empty()) {
+            end->execution_failed =
+                "Iteration " + std::to_string(i) + ": " + failures[i];
+            return false;
+        }
+    }
+    params.set_output("Results", std::move(results));
+    auto captured_inputs =
+        zone.begin->find_socket_group_ids("Captured", PinKind::Input);
+    auto captured_outputs =
+        end->find_socket_group_ids("Captured", PinKind::Output);
+    for (size_t k = 0; k < captured_outputs.size(); ++k) {
+        auto value = k < captured_inputs.size()
+                         ? zone_outer_value(
+                               zone.begin->get_inputs()[captured_inputs[k]])
+                         : nullptr;
+        *params.outputs_[captured_outputs[k]] =
+            value ? *value : entt::meta_any{};
+    }
+
+    // They ran with the zone, so their changes dirty it again
+    for (auto* node : zone.body) {
+        mark_node_clean(node);
+    }
+    return true;
 }
 
 void EagerNodeTreeExecutor::prepare_memory()
@@ -538,10 +1224,13 @@ void EagerNodeTreeExecutor::prepare_memory()
             }
             else {
                 // Type mismatch! Discard old cached value and reinitialize
+                record_dirty_event(
+                    DirtyCause::TypeMismatch, socket->node, nullptr, socket);
                 new_input_states[i] =
                     RuntimeInputState{};  // Zero-initialize all fields
                 if (socket_type) {
                     new_input_states[i].value = socket_type.construct();
+                    counters.values_constructed++;
                 }
                 new_input_states[i].is_cached = false;
             }
@@ -551,6 +1240,7 @@ void EagerNodeTreeExecutor::prepare_memory()
             auto type = socket->type_info;
             if (type) {
                 new_input_states[i].value = type.construct();
+                counters.values_constructed++;
             }
             new_input_states[i].is_cached = false;
         }
@@ -586,10 +1276,13 @@ void EagerNodeTreeExecutor::prepare_memory()
             }
             else {
                 // Type mismatch! Discard old cached value and reinitialize
+                record_dirty_event(
+                    DirtyCause::TypeMismatch, socket->node, nullptr, socket);
                 new_output_states[i] =
                     RuntimeOutputState{};  // Zero-initialize all fields
                 if (socket_type) {
                     new_output_states[i].value = socket_type.construct();
+                    counters.values_constructed++;
                 }
                 new_output_states[i].is_cached = false;
             }
@@ -599,6 +1292,7 @@ void EagerNodeTreeExecutor::prepare_memory()
             auto type = socket->type_info;
             if (type) {
                 new_output_states[i].value = type.construct();
+                counters.values_constructed++;
             }
             new_output_states[i].is_cached = false;
         }
@@ -632,6 +1326,7 @@ void EagerNodeTreeExecutor::refresh_storage()
                     auto input = node->get_inputs()[0];
                     std::string name =
                         input->default_value_typed<std::string>();
+                    counters.storage_lookups++;
                     if (storage.find(name) == storage.end()) {
                         data = socket->directly_linked_sockets[0]
                                    ->type_info.construct();
@@ -686,6 +1381,7 @@ bool EagerNodeTreeExecutor::try_fill_storage_to_node(
         if (std::string(node->typeinfo->id_name) == "func_storage_out") {
             auto input = node->get_inputs()[0];
             std::string name = input->default_value_typed<std::string>();
+            counters.storage_lookups++;
             if (storage.find(name) != storage.end()) {
                 auto& storaged_value = storage.at(name);
 
@@ -723,103 +1419,434 @@ bool EagerNodeTreeExecutor::try_fill_storage_to_node(
 
 EagerNodeTreeExecutor::~EagerNodeTreeExecutor()
 {
+    finish_streaming_nodes(false);
     storage.clear();
 }
 
+bool EagerNodeTreeExecutor::structure_changed_since_prepare(
+    NodeTree* tree) const
+{
+    return tree != prepared_tree ||
+           tree->structure_version() != prepared_structure_version;
+}
+
 void EagerNodeTreeExecutor::prepare_tree(NodeTree* tree, Node* required_node)
 {
+    // The nodes and sockets of an unfinished run on an edited tree may be
+    // gone. Drop the run without touching them.
+    if (run_in_progress && structure_changed_since_prepare(tree)) {
+        mark_tree_structure_changed();
+    }
+
+    // Restart an unfinished time-sliced run. The nodes it executed are
+    // clean, keep their results.
+    if (run_in_progress) {
+        finish_streaming_nodes();
+        while (!pending_outputs.empty()) {
+            complete_pending(tree, pending_outputs.begin()->first);
+        }
+        postponed_nodes.clear();
+        waiting_nodes.clear();
+        save_states();
+        run_in_progress = false;
+    }
+
     tree->ensure_topology_cache();
 
     // Only clear execution state, not cache
     clear();
 
     compile(tree, required_node);
+    prepared_tree = tree;
+    prepared_structure_version = tree->structure_version();
 
     // prepare_memory will now handle resizing and cache preservation
     prepare_memory();
+    detect_default_changes(tree);
+
+    // Also keeps them out of the quality cache
+    collect_time_dependent_nodes();
 
     refresh_storage();
 }
 
-void EagerNodeTreeExecutor::execute_tree(NodeTree* tree)
+void EagerNodeTreeExecutor::run_node(NodeTree* tree, Node* node)
 {
-    for (int i = 0; i < nodes_to_execute_count; ++i) {
-        auto node = nodes_to_execute[i];
+    // Time-dependent nodes of an already evaluated frame
+    if (!produces_streams(node) && restore_frame_outputs(node)) {
+        counters.frame_cache_hits++;
+        forward_output_to_input(node);
+        return;
+    }
+
+    // Dirty only for a quality it already ran at
+    if (is_node_dirty(node) && restore_quality_outputs(node)) {
+        counters.quality_cache_hits++;
+        forward_output_to_input(node);
+        mark_node_clean(node);
+        return;
+    }
 
-        // ALWAYS_DIRTY nodes must always execute and propagate dirty state
-        // downstream
-        bool force_execute = node->typeinfo->ALWAYS_DIRTY;
+    // ALWAYS_DIRTY nodes must always execute and propagate dirty state
+    // downstream
+    bool force_execute = always_dirty(node);
 
-        // Skip execution if node is clean and has valid cache (unless
-        // ALWAYS_DIRTY)
-        if (!force_execute && !is_node_dirty(node)) {
-            int cached_inputs = 0, total_inputs = 0;
-            int cached_outputs = 0, total_outputs = 0;
+    // Skip execution if node is clean and has valid cache (unless
+    // ALWAYS_DIRTY)
+    if (!force_execute && !is_node_dirty(node)) {
+        int cached_inputs = 0, total_inputs = 0;
+        int cached_outputs = 0, total_outputs = 0;
 
-            for (auto* input : node->get_inputs()) {
-                if (index_cache.find(input) != index_cache.end()) {
-                    total_inputs++;
-                    if (input_states[index_cache[input]].is_cached) {
-                        cached_inputs++;
-                    }
+        for (auto* input : node->get_inputs()) {
+            if (index_cache.find(input) != index_cache.end()) {
+                total_inputs++;
+                // Linked lazy inputs are only filled on request. Changes
+                // upstream of them still reach the node as dirtiness.
+                bool pending_lazy =
+                    input->lazy && !input->directly_linked_sockets.empty();
+                if (pending_lazy ||
+                    input_states[index_cache[input]].is_cached) {
+                    cached_inputs++;
                 }
             }
+        }
 
-            for (auto* output : node->get_outputs()) {
-                if (index_cache.find(output) != index_cache.end()) {
-                    total_outputs++;
-                    if (output_states[index_cache[output]].is_cached) {
-                        cached_outputs++;
-                    }
+        for (auto* output : node->get_outputs()) {
+            if (index_cache.find(output) != index_cache.end()) {
+                total_outputs++;
+                if (output_states[index_cache[output]].is_cached) {
+                    cached_outputs++;
                 }
             }
-
-            bool all_cached = (cached_inputs == total_inputs) &&
-                              (cached_outputs == total_outputs);
-
-            if (all_cached && total_inputs > 0 && total_outputs > 0) {
-                // Node is clean and cached, forward cached outputs
-                forward_output_to_input(node);
-                continue;
-            }
         }
 
-        // Execute node
-        auto result = execute_node(tree, node);
-        if (result) {
+        bool all_cached = (cached_inputs == total_inputs) &&
+                          (cached_outputs == total_outputs);
+
+        if (all_cached && total_inputs > 0 && total_outputs > 0) {
+            // Node is clean and cached, forward cached outputs
+            counters.nodes_skipped++;
             forward_output_to_input(node);
+            return;
+        }
+    }
 
-            // ALWAYS_DIRTY nodes should invalidate downstream nodes
-            if (node->typeinfo->ALWAYS_DIRTY) {
-                // Mark all downstream nodes as dirty
-                for (auto* output : node->get_outputs()) {
-                    for (auto* linked_socket :
-                         output->directly_linked_sockets) {
-                        mark_node_dirty(linked_socket->node);
-                        invalidate_cache_for_node(linked_socket->node);
-                    }
-                }
-            }
+    // Execute node, remembering why
+    if (force_execute) {
+        record_dirty_event(DirtyCause::AlwaysDirty, node);
+    }
+    auto dirty_event = node_dirty_event.find(node);
+    executed_last_run[node] = dirty_event != node_dirty_event.end()
+                                  ? dirty_event->second
+                                  : structure_changed_event;
+
+    reused_pure_result = false;
+    auto result = execute_node(tree, node);
+    if (!result) {
+        report_failure(tree, node);
+        pending_outputs.erase(node);
+    }
+    else if (pending_outputs.count(node)) {
+        // Finished by complete_pending() once its outputs arrive
+        waiting_nodes.insert(node);
+    }
+    else {
+        finish_node(node, reused_pure_result);
+    }
+}
 
-            // Mark node as clean and cache as valid (unless ALWAYS_DIRTY)
-            if (!node->typeinfo->ALWAYS_DIRTY) {
-                mark_node_clean(node);
-            }
-            for (auto* input : node->get_inputs()) {
-                if (index_cache.find(input) != index_cache.end()) {
-                    input_states[index_cache[input]].is_cached = true;
-                }
-            }
-            for (auto* output : node->get_outputs()) {
-                if (index_cache.find(output) != index_cache.end()) {
-                    output_states[index_cache[output]].is_cached = true;
-                }
+void EagerNodeTreeExecutor::finish_node(Node* node, bool reused_pure)
+{
+    if (reused_pure)
+        counters.pure_reuses++;
+    else
+        counters.nodes_executed++;
+    forward_output_to_input(node);
+
+    // ALWAYS_DIRTY nodes should invalidate downstream nodes
+    if (always_dirty(node)) {
+        // Mark all downstream nodes as dirty
+        for (auto* output : node->get_outputs()) {
+            for (auto* linked_socket : output->directly_linked_sockets) {
+                mark_node_dirty(
+                    linked_socket->node, DirtyCause::UpstreamDirty, node);
+                invalidate_cache_for_node(linked_socket->node);
             }
         }
     }
 
-    try_storage();
+    // Mark node as clean and cache as valid (unless ALWAYS_DIRTY)
+    if (!always_dirty(node)) {
+        mark_node_clean(node);
+    }
+    for (auto* input : node->get_inputs()) {
+        if (index_cache.find(input) != index_cache.end()) {
+            input_states[index_cache[input]].is_cached = true;
+        }
+    }
+    for (auto* output : node->get_outputs()) {
+        if (index_cache.find(output) != index_cache.end()) {
+            output_states[index_cache[output]].is_cached = true;
+        }
+    }
+    store_frame_outputs(node);
+    store_quality_outputs(node);
+}
+
+bool EagerNodeTreeExecutor::produces_streams(Node* node) const
+{
+    return stream_producers.count(node) != 0;
+}
+
+bool EagerNodeTreeExecutor::always_dirty(Node* node) const
+{
+    return node->typeinfo->ALWAYS_DIRTY || produces_streams(node);
+}
+
+void EagerNodeTreeExecutor::start_streaming_node(Node* node, ExeParams params)
+{
+    // The thread cannot call back into the executor, so lazy inputs are read
+    // now
+    for (auto*& lazy_input : params.lazy_inputs_) {
+        if (lazy_input)
+            evaluate_lazy_input(std::exchange(lazy_input, nullptr));
+    }
+    params.executor = nullptr;
+
+    // Fresh streams, forwarded to the consumers as soon as this returns
+    std::vector<std::shared_ptr<ChunkChannelBase>> streams;
+    auto& outputs = node->get_outputs();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        if (!is_chunk_stream_type(outputs[i]->type_info.id()))
+            continue;
+        *params.outputs_[i] = outputs[i]->type_info.construct();
+        streams.push_back(find_chunk_channel(*params.outputs_[i]));
+    }
+
+    auto failure = std::async(
+        std::launch::async, [params, streams]() mutable -> std::string {
+            std::string failure;
+            try {
+                if (!params.node_.typeinfo->node_execute(params))
+                    failure = "Execution failed";
+            }
+            catch (const std::exception& e) {
+                failure = e.what();
+            }
+            // Consumers stop waiting even if the node forgot to
+            for (auto& stream : streams) {
+                stream->close();
+            }
+            return failure;
+        });
+    streaming_nodes.push_back({ node, std::move(streams), std::move(failure) });
+}
+
+void EagerNodeTreeExecutor::finish_streaming_nodes(bool nodes_alive)
+{
+    // Latest first: once the later ones returned, nothing reads the streams
+    // of the earlier ones any more, cancelling them only releases a producer
+    // blocked on a stream nobody drained.
+    while (!streaming_nodes.empty()) {
+        auto& streaming = streaming_nodes.back();
+        for (auto& stream : streaming.streams) {
+            stream->cancel();
+        }
+        auto failure = streaming.failure.get();
+        if (!failure.empty() && nodes_alive) {
+            streaming.node->execution_failed = failure;
+            report_failure(prepared_tree, streaming.node);
+        }
+        streaming_nodes.pop_back();
+    }
+}
+
+bool EagerNodeTreeExecutor::defer_output(
+    Node* node,
+    int output_index,
+    std::shared_ptr<PendingValue> value)
+{
+    if (!executing_tree) {
+        return false;
+    }
+    pending_outputs[node].emplace_back(output_index, std::move(value));
+    return true;
+}
+
+bool EagerNodeTreeExecutor::waits_on_pending(Node* node) const
+{
+    if (waiting_nodes.empty()) {
+        return false;
+    }
+    for (auto* input : node->get_inputs()) {
+        for (auto* linked_socket : input->directly_linked_sockets) {
+            if (waiting_nodes.count(linked_socket->node))
+                return true;
+        }
+    }
+    return false;
+}
+
+void EagerNodeTreeExecutor::report_failure(NodeTree* tree, Node* node)
+{
+    counters.nodes_failed++;
+    pure_input_hashes.erase(node);
+    // Missing inputs are reported on their own
+    if (!node->MISSING_INPUT)
+        diagnose<DiagnosticCode::NodeFailed>(tree, node->ID.Get());
+}
+
+void EagerNodeTreeExecutor::complete_pending(NodeTree* tree, Node* node)
+{
+    auto outputs = std::move(pending_outputs[node]);
+    pending_outputs.erase(node);
+    waiting_nodes.erase(node);
+
+    bool succeeded = true;
+    for (auto& [index, value] : outputs) {
+        auto socket = node->get_outputs()[index];
+        try {
+            output_states[index_cache[socket]].value = value->get();
+        }
+        catch (const std::exception& e) {
+            node->execution_failed = e.what();
+            succeeded = false;
+        }
+        catch (...) {
+            node->execution_failed = "Unknown exception";
+            succeeded = false;
+        }
+    }
+    if (!succeeded) {
+        // Downstream nodes see the input missing
+        report_failure(tree, node);
+        return;
+    }
+    counters.async_completions++;
+    finish_node(node, false);
+}
+
+void EagerNodeTreeExecutor::resume_pending(NodeTree* tree, bool wait)
+{
+    while (true) {
+        std::vector<Node*> completed;
+        for (auto& [node, outputs] : pending_outputs) {
+            bool ready = true;
+            for (auto& [index, value] : outputs) {
+                ready = ready && (wait || value->ready());
+            }
+            if (ready)
+                completed.push_back(node);
+        }
+        if (completed.empty()) {
+            return;
+        }
+        for (auto* node : completed) {
+            complete_pending(tree, node);
+        }
+
+        // Plan order, so a node is checked after everything upstream of it.
+        // It may go pending itself.
+        auto postponed = std::move(postponed_nodes);
+        postponed_nodes.clear();
+        for (auto* node : postponed) {
+            waiting_nodes.erase(node);
+        }
+        for (auto* node : postponed) {
+            if (waits_on_pending(node)) {
+                postponed_nodes.push_back(node);
+                waiting_nodes.insert(node);
+            }
+            else {
+                run_node(tree, node);
+            }
+        }
+    }
+}
+
+void EagerNodeTreeExecutor::execute_tree(NodeTree* tree)
+{
+    while (!execute_tree_for(tree, std::numeric_limits<double>::infinity())) {
+    }
+}
+
+bool EagerNodeTreeExecutor::execute_tree_for(NodeTree* tree, double budget_ms)
+{
+    // Resuming after an edit, the whole tree is planned again
+    if (run_in_progress && structure_changed_since_prepare(tree)) {
+        prepare_tree(tree);
+    }
+    if (!run_in_progress) {
+        begin_run(tree);
+    }
+
+    // At least one node per call, so every call makes progress
+    bool timed = std::isfinite(budget_ms);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration<double, std::milli>(
+                        timed ? budget_ms : 0.0);
+
+    executing_tree = tree;
+    while (execution_cursor < nodes_to_execute_count) {
+        auto node = nodes_to_execute[execution_cursor++];
+        if (deferred_nodes.count(node) || zone_body_nodes.count(node))
+            continue;
+        if (waits_on_pending(node)) {
+            postponed_nodes.push_back(node);
+            waiting_nodes.insert(node);
+            continue;
+        }
+        run_node(tree, node);
+        if (!pending_outputs.empty())
+            resume_pending(tree, false);
+        if (safe_point)
+            safe_point();
+        if (execution_cursor < nodes_to_execute_count &&
+            (pause_requested.exchange(false, std::memory_order_relaxed) ||
+             (timed && std::chrono::steady_clock::now() >= deadline))) {
+            executing_tree = nullptr;
+            return false;
+        }
+    }
+
+    // Only outputs still loading are left. A timed call leaves them to the
+    // next one rather than blocking.
+    resume_pending(tree, !timed);
+    executing_tree = nullptr;
+    if (!pending_outputs.empty()) {
+        return false;
+    }
+
+    finish_streaming_nodes();
+    finish_run(tree);
+    return true;
+}
 
+bool EagerNodeTreeExecutor::has_unfinished_run() const
+{
+    return run_in_progress;
+}
+
+void EagerNodeTreeExecutor::begin_run(NodeTree* tree)
+{
+    if (recorder) {
+        recorder->begin_run(tree, global_payload);
+    }
+    // The payload changed at the same frame, the cached frames were
+    // evaluated with the old one
+    if (std::exchange(payload_changed_since_run, false) &&
+        current_frame == last_run_frame)
+        invalidate_result_caches();
+    last_run_frame = current_frame;
+
+    executed_last_run.clear();
+    evaluated_deferred_nodes.clear();
+    execution_cursor = 0;
+    run_in_progress = true;
+}
+
+void EagerNodeTreeExecutor::save_states()
+{
     // Save all current states back to persistent cache for next execution
     // IMPORTANT: Copy, not move! We need the values to remain accessible for
     // sync_node_to_external_storage
@@ -832,6 +1859,18 @@ void EagerNodeTreeExecutor::execute_tree(NodeTree* tree)
             persistent_output_cache[socket] = output_states[index];  // Copy
         }
     }
+}
+
+void EagerNodeTreeExecutor::finish_run(NodeTree* tree)
+{
+    run_in_progress = false;
+
+    try_storage();
+
+    // Only entries new since the last run are logged.
+    diagnostics().flush_to_log(tree);
+
+    save_states();
 
     // Clean up dirty nodes that were executed, but DON'T clear nodes marked
     // dirty during execution (e.g., downstream nodes that got updated values
@@ -843,7 +1882,8 @@ void EagerNodeTreeExecutor::execute_tree(NodeTree* tree)
         bool was_executed = false;
         for (int i = 0; i < nodes_to_execute_count; ++i) {
             if (nodes_to_execute[i] == dirty_node) {
-                was_executed = true;
+                was_executed = !deferred_nodes.count(dirty_node) ||
+                               evaluated_deferred_nodes.count(dirty_node);
                 break;
             }
         }
@@ -852,6 +1892,52 @@ void EagerNodeTreeExecutor::execute_tree(NodeTree* tree)
         }
     }
     dirty_nodes = nodes_to_keep_dirty;
+    run_count++;
+    publish_results(tree);
+
+    if (recorder) {
+        std::vector<Node*> executed;
+        for (int i = 0; i < nodes_to_execute_count; ++i) {
+            if (executed_last_run.contains(nodes_to_execute[i]))
+                executed.push_back(nodes_to_execute[i]);
+        }
+        recorder->end_run(this, executed);
+    }
+}
+
+void EagerNodeTreeExecutor::publish_results(NodeTree* tree)
+{
+    auto subscriptions = result_publisher.subscriptions();
+    if (subscriptions.empty()) {
+        return;
+    }
+
+    auto previous = result_publisher.latest();
+    auto snapshot = std::make_shared<ResultSnapshot>();
+    snapshot->epoch = run_count;
+    snapshot->quality = quality;
+    for (auto id : subscriptions) {
+        auto socket = tree->find_pin(SocketID(id));
+        if (!socket) {
+            continue;
+        }
+        auto found = FindPtr(socket);
+        if (!found || !*found) {
+            continue;
+        }
+        auto& value = *found;
+        // Readers may still hold the previous value, share it when equal
+        if (previous) {
+            auto it = previous->values.find(id);
+            if (it != previous->values.end() && *it->second == value) {
+                snapshot->values.emplace(id, it->second);
+                continue;
+            }
+        }
+        snapshot->values.emplace(
+            id, std::make_shared<const entt::meta_any>(value));
+    }
+    result_publisher.publish(std::move(snapshot));
 }
 
 entt::meta_any* EagerNodeTreeExecutor::FindPtr(NodeSocket* socket)
@@ -867,8 +1953,7 @@ entt::meta_any* EagerNodeTreeExecutor::FindPtr(NodeSocket* socket)
             if (it != persistent_input_cache.end()) {
                 return &it->second.value;
             }
-            static entt::meta_any default_any;
-            return &default_any;
+            return nullptr;
         }
     }
     else {
@@ -881,8 +1966,7 @@ entt::meta_any* EagerNodeTreeExecutor::FindPtr(NodeSocket* socket)
             if (it != persistent_output_cache.end()) {
                 return &it->second.value;
             }
-            static entt::meta_any default_any;
-            return &default_any;
+            return nullptr;
         }
     }
     return ptr;
@@ -892,61 +1976,113 @@ void EagerNodeTreeExecutor::sync_node_from_external_storage(
     NodeSocket* socket,
     const entt::meta_any& data)
 {
-    if (index_cache.find(socket) != index_cache.end()) {
-        entt::meta_any* ptr = FindPtr(socket);
-
-        // Check if data actually changed
-        bool data_changed =
-            !(*ptr) || (*ptr).type() != data.type() || *ptr != data;
-
-        *ptr = data;
-
-        // if it has dataField, fill it
-        if (socket->in_out == PinKind::Input) {
-            if (socket->dataField.value) {
-                socket->dataField.value = data;
-            }
-            input_states[index_cache[socket]].is_forwarded = true;
-            input_states[index_cache[socket]].is_cached = false;
-
-            // Persist to cache so prepare_tree() doesn't lose the value
-            persistent_input_cache[socket] = input_states[index_cache[socket]];
-
-            // Mark node and downstream nodes dirty if data changed
-            if (data_changed) {
-                mark_node_dirty(socket->node);
-                invalidate_cache_for_node(socket->node);
-
-                // Propagate dirty to downstream nodes
-                for (auto* output : socket->node->get_outputs()) {
-                    for (auto* linked_socket :
-                         output->directly_linked_sockets) {
-                        Node* downstream = linked_socket->node;
-                        if (!is_node_dirty(downstream)) {
-                            mark_node_dirty(downstream);
-                            invalidate_cache_for_node(downstream);
-
-                            // Recursively propagate downstream
-                            std::vector<Node*> to_visit = { downstream };
-                            while (!to_visit.empty()) {
-                                Node* current = to_visit.back();
-                                to_visit.pop_back();
-
-                                for (auto* out : current->get_outputs()) {
-                                    for (auto* linked :
-                                         out->directly_linked_sockets) {
-                                        Node* next = linked->node;
-                                        if (!is_node_dirty(next)) {
-                                            mark_node_dirty(next);
-                                            invalidate_cache_for_node(next);
-                                            to_visit.push_back(next);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+    if (recorder) {
+        recorder->record_input(socket, data);
+    }
+
+    if (apply_external_input(socket, entt::meta_any{ data })) {
+        mark_external_inputs_dirty({ socket });
+    }
+}
+
+void EagerNodeTreeExecutor::sync_batch_from_external_storage(
+    std::vector<std::pair<NodeSocket*, entt::meta_any>>& inputs)
+{
+    std::vector<NodeSocket*> changed;
+    for (auto& [socket, value] : inputs) {
+        if (recorder) {
+            recorder->record_input(socket, value);
+        }
+        if (apply_external_input(socket, std::move(value))) {
+            changed.push_back(socket);
+        }
+    }
+    mark_external_inputs_dirty(changed);
+}
+
+bool EagerNodeTreeExecutor::apply_external_input(
+    NodeSocket* socket,
+    entt::meta_any&& data)
+{
+    auto index = index_cache.find(socket);
+    if (index == index_cache.end()) {
+        return false;
+    }
+    entt::meta_any* ptr = FindPtr(socket);
+
+    // Check if data actually changed
+    bool data_changed =
+        !(*ptr) || (*ptr).type() != data.type() || *ptr != data;
+
+    if (socket->in_out == PinKind::Output) {
+        *ptr = std::move(data);
+        return false;
+    }
+
+    auto& state = input_states[index->second];
+    state.default_version = 0;
+    if (fork_parent && socket->dataField.value) {
+        // The tree is shared with the parent, the fork keeps its own
+        default_overrides[socket] = data;
+    }
+    // if it has dataField, fill it
+    else if (socket->dataField.value) {
+        auto& field = socket->dataField.value;
+        if (field.type() != data.type() || field != data) {
+            field = data;
+            socket->mark_default_changed();
+        }
+        // Already holds the default, nothing to copy next run
+        state.default_version = socket->dataField.version;
+    }
+    *ptr = std::move(data);
+    state.is_forwarded = true;
+    state.is_cached = false;
+
+    // Persist to cache so prepare_tree() doesn't lose the value. A default
+    // is copied in again from the socket, see prepare_params().
+    if (!socket->dataField.value) {
+        persistent_input_cache[socket] = state;
+    }
+    return data_changed;
+}
+
+void EagerNodeTreeExecutor::mark_external_inputs_dirty(
+    const std::vector<NodeSocket*>& sockets)
+{
+    if (sockets.empty()) {
+        return;
+    }
+    invalidate_result_caches();
+
+    // All sources first, so a source downstream of another keeps its own
+    // cause.
+    std::vector<std::pair<Node*, Node*>> to_visit;
+    for (auto* socket : sockets) {
+        mark_node_dirty(
+            socket->node, DirtyCause::ExternalInput, nullptr, socket);
+        invalidate_cache_for_node(socket->node);
+        for (auto* output : socket->node->get_outputs()) {
+            for (auto* linked_socket : output->directly_linked_sockets) {
+                to_visit.emplace_back(linked_socket->node, socket->node);
+            }
+        }
+    }
+
+    // One walk for all of them, each node is entered once
+    while (!to_visit.empty()) {
+        auto [current, source] = to_visit.back();
+        to_visit.pop_back();
+
+        if (is_node_dirty(current)) {
+            continue;
+        }
+        mark_node_dirty(current, DirtyCause::UpstreamDirty, source);
+        invalidate_cache_for_node(current);
+
+        for (auto* output : current->get_outputs()) {
+            for (auto* linked_socket : output->directly_linked_sockets) {
+                to_visit.emplace_back(linked_socket->node, current);
             }
         }
     }
@@ -967,6 +2103,87 @@ std::shared_ptr<NodeTreeExecutor> EagerNodeTreeExecutor::clone_empty() const
     return std::make_shared<EagerNodeTreeExecutor>();
 }
 
+std::shared_ptr<NodeTreeExecutor> EagerNodeTreeExecutor::fork()
+{
+    if (run_in_progress) {
+        throw std::runtime_error("Cannot fork an executor during a run");
+    }
+
+    if (prepared_tree) {
+        for (auto& node : prepared_tree->nodes) {
+            if (holds_state(node.get()))
+                return nullptr;
+        }
+    }
+
+    // What survives prepare_tree(), so the fork prepares as this one would
+    auto forked = std::make_shared<EagerNodeTreeExecutor>();
+    forked->fork_parent = this;
+    forked->global_payload = global_payload;
+    forked->default_overrides = default_overrides;
+    forked->persistent_input_cache = persistent_input_cache;
+    forked->persistent_output_cache = persistent_output_cache;
+    forked->storage = storage;
+    forked->dirty_nodes = dirty_nodes;
+    forked->node_dirty_cache = node_dirty_cache;
+    forked->payload_reads = payload_reads;
+    forked->pure_input_hashes = pure_input_hashes;
+    forked->quality = quality;
+    forked->quality_readers = quality_readers;
+    forked->quality_dependent_nodes = quality_dependent_nodes;
+    forked->quality_cache = quality_cache;
+    return forked;
+}
+
+bool EagerNodeTreeExecutor::commit_fork(NodeTreeExecutor& fork)
+{
+    auto forked = dynamic_cast<EagerNodeTreeExecutor*>(&fork);
+    if (!forked || forked->fork_parent != this) {
+        return false;
+    }
+    if (run_in_progress || forked->run_in_progress) {
+        throw std::runtime_error("Cannot commit a fork during a run");
+    }
+
+    for (auto& [socket, value] : forked->default_overrides) {
+        if (fork_parent) {
+            default_overrides[socket] = std::move(value);
+        }
+        else {
+            socket->dataField.value = std::move(value);
+            socket->mark_default_changed();
+        }
+    }
+    forked->default_overrides.clear();
+
+    // The fork's results are those of the tree now. Runtime states are
+    // rebuilt from the persistent caches by the next prepare_tree().
+    global_payload = std::move(forked->global_payload);
+    persistent_input_cache = std::move(forked->persistent_input_cache);
+    persistent_output_cache = std::move(forked->persistent_output_cache);
+    storage = std::move(forked->storage);
+    dirty_nodes = std::move(forked->dirty_nodes);
+    node_dirty_cache = std::move(forked->node_dirty_cache);
+    node_dirty_event.clear();
+    payload_reads = std::move(forked->payload_reads);
+    pure_input_hashes = std::move(forked->pure_input_hashes);
+    quality = forked->quality;
+    quality_readers = std::move(forked->quality_readers);
+    quality_dependent_nodes = std::move(forked->quality_dependent_nodes);
+
+    clear();
+    index_cache.clear();
+    input_states.clear();
+    output_states.clear();
+    invalidate_result_caches();
+
+    forked->fork_parent = nullptr;
+    forked->index_cache.clear();
+    forked->input_states.clear();
+    forked->output_states.clear();
+    return true;
+}
+
 std::set<Node*> EagerNodeTreeExecutor::get_dirty_nodes() const
 {
     return dirty_nodes;
@@ -974,10 +2191,397 @@ std::set<Node*> EagerNodeTreeExecutor::get_dirty_nodes() const
 
 void EagerNodeTreeExecutor::set_nodes_dirty(const std::set<Node*>& nodes)
 {
+    if (!nodes.empty())
+        invalidate_result_caches();
     for (auto* node : nodes) {
-        mark_node_dirty(node);
+        mark_node_dirty(node, DirtyCause::Restored);
         invalidate_cache_for_node(node);
     }
 }
 
+ExecutorCounters EagerNodeTreeExecutor::get_counters() const
+{
+    auto result = counters;
+    result.persistent_cache_bytes = 0;
+    for (auto& [socket, state] : persistent_input_cache) {
+        result.persistent_cache_bytes += estimate_value_size(state.value);
+    }
+    for (auto& [socket, state] : persistent_output_cache) {
+        result.persistent_cache_bytes += estimate_value_size(state.value);
+    }
+    return result;
+}
+
+void EagerNodeTreeExecutor::reset_counters()
+{
+    counters = {};
+}
+
+MemoryReport EagerNodeTreeExecutor::memory_report() const
+{
+    MemoryReport report;
+    for (auto& [socket, index] : index_cache) {
+        auto& value = socket->in_out == PinKind::Input
+                          ? input_states[index].value
+                          : output_states[index].value;
+        report.add(value, "current", socket->node, socket);
+    }
+    for (auto& [socket, state] : persistent_input_cache) {
+        report.add(state.value, "persistent", socket->node, socket);
+    }
+    for (auto& [socket, state] : persistent_output_cache) {
+        report.add(state.value, "persistent", socket->node, socket);
+    }
+    for (auto& [frame, cached] : frame_cache) {
+        for (auto& [node, values] : cached.outputs) {
+            for (auto& value : values) {
+                report.add(value, "frame_cache", node);
+            }
+        }
+    }
+    for (auto& [quality, outputs] : quality_cache) {
+        for (auto& [node, values] : outputs) {
+            for (auto& value : values) {
+                report.add(value, "quality_cache", node);
+            }
+        }
+    }
+    for (auto* node : nodes_to_execute) {
+        if (node->is_node_group() && node->storage) {
+            // What the subtree retains is held by the group's executor
+            auto& group = node->storage.cast<NodeGroupStorage&>();
+            if (group.executor)
+                report.merge(group.executor->memory_report(), node);
+            continue;
+        }
+        report.add(node->storage, "node_storage", node);
+    }
+    for (auto& [name, value] : storage) {
+        report.add(value, "func_storage");
+    }
+    return report;
+}
+
+void EagerNodeTreeExecutor::record_dirty_event(
+    DirtyCause cause,
+    Node* node,
+    Node* source,
+    NodeSocket* socket)
+{
+    if (!dirty_event_capacity) {
+        return;
+    }
+    if (dirty_events.size() != dirty_event_capacity) {
+        dirty_events.resize(dirty_event_capacity);
+    }
+
+    auto& event = dirty_events[dirty_event_count % dirty_event_capacity];
+    event = DirtyEvent{};
+    event.sequence = ++dirty_event_count;
+    event.run = run_count;
+    event.cause = cause;
+    if (node) {
+        event.node = node->ID.Get();
+        node_dirty_event[node] = event.sequence;
+    }
+    if (socket) {
+        event.socket = socket->ID.Get();
+    }
+    if (source) {
+        event.source = source->ID.Get();
+        auto parent = node_dirty_event.find(source);
+        if (parent != node_dirty_event.end())
+            event.parent = parent->second;
+    }
+}
+
+const DirtyEvent* EagerNodeTreeExecutor::find_dirty_event(
+    uint64_t sequence) const
+{
+    if (!sequence || dirty_events.empty()) {
+        return nullptr;
+    }
+    auto& event = dirty_events[(sequence - 1) % dirty_events.size()];
+    // Overwritten by a newer one
+    return event.sequence == sequence ? &event : nullptr;
+}
+
+std::vector<DirtyEvent> EagerNodeTreeExecutor::dirty_cause_chain(
+    Node* node) const
+{
+    std::vector<DirtyEvent> chain;
+    auto executed = executed_last_run.find(node);
+    if (executed == executed_last_run.end()) {
+        return chain;
+    }
+    // Parents are always older, so this terminates.
+    auto event = find_dirty_event(executed->second);
+    while (event) {
+        chain.push_back(*event);
+        event = find_dirty_event(event->parent);
+    }
+    return chain;
+}
+
+std::string EagerNodeTreeExecutor::explain_execution(Node* node) const
+{
+    std::ostringstream text;
+    text << "Node '" << node->ui_name << "' (" << node->ID.Get() << ")";
+    if (!executed_last_run.contains(node)) {
+        text << " did not execute in the last run";
+        return text.str();
+    }
+
+    auto chain = dirty_cause_chain(node);
+    if (chain.empty()) {
+        text << " executed because it had no cached result";
+        return text.str();
+    }
+    text << " executed because of:";
+    for (auto& event : chain) {
+        text << "\n  " << dirty_cause_name(event.cause);
+        if (event.node)
+            text << " on node " << event.node;
+        if (event.socket)
+            text << ", socket " << event.socket;
+        if (event.source)
+            text << ", from node " << event.source;
+        text << " (run " << event.run << ")";
+    }
+    if (chain.back().parent) {
+        text << "\n  ... older events were dropped";
+    }
+    return text.str();
+}
+
+void EagerNodeTreeExecutor::set_dirty_trace_capacity(size_t capacity)
+{
+    dirty_event_capacity = capacity;
+    dirty_events.clear();
+    node_dirty_event.clear();
+    executed_last_run.clear();
+}
+
+void EagerNodeTreeExecutor::enable_frame_cache(
+    size_t frame_budget_bytes,
+    size_t max_frames)
+{
+    frame_cache_enabled = true;
+    frame_cache_budget = frame_budget_bytes;
+    frame_cache_max_frames = max_frames;
+    // The cone is collected again by the next prepare_tree()
+    time_dependent_nodes.clear();
+}
+
+void EagerNodeTreeExecutor::disable_frame_cache()
+{
+    frame_cache_enabled = false;
+    current_frame.reset();
+    frame_cache.clear();
+    time_dependent_nodes.clear();
+}
+
+void EagerNodeTreeExecutor::set_frame(int64_t frame)
+{
+    current_frame = frame;
+}
+
+bool EagerNodeTreeExecutor::is_frame_cached(int64_t frame) const
+{
+    return frame_cache.contains(frame);
+}
+
+void EagerNodeTreeExecutor::invalidate_result_caches()
+{
+    // Cached results were computed from inputs that no longer hold
+    frame_cache.clear();
+    quality_cache.clear();
+}
+
+void EagerNodeTreeExecutor::collect_time_dependent_nodes()
+{
+    time_dependent_nodes.clear();
+    stateful_nodes.clear();
+    always_dirty_cone.clear();
+
+    // nodes_to_execute is in topological order, upstream cone members are
+    // always visited first.
+    for (int i = 0; i < nodes_to_execute_count; ++i) {
+        auto node = nodes_to_execute[i];
+        bool time_dependent = node->typeinfo->ALWAYS_DIRTY;
+        for (auto* input : node->get_inputs()) {
+            if (time_dependent)
+                break;
+            for (auto* upstream : input->directly_linked_sockets) {
+                if (time_dependent_nodes.contains(upstream->node)) {
+                    time_dependent = true;
+                    break;
+                }
+            }
+        }
+        if (time_dependent) {
+            time_dependent_nodes.insert(node);
+        }
+
+        bool in_dirty_cone = always_dirty(node);
+        for (auto* input : node->get_inputs()) {
+            for (auto* upstream : input->directly_linked_sockets) {
+                in_dirty_cone =
+                    in_dirty_cone || always_dirty_cone.contains(upstream->node);
+            }
+        }
+        if (in_dirty_cone) {
+            always_dirty_cone.insert(node);
+        }
+
+        bool stateful = holds_state(node);
+        for (auto* input : node->get_inputs()) {
+            for (auto* upstream : input->directly_linked_sockets) {
+                stateful = stateful || stateful_nodes.contains(upstream->node);
+            }
+        }
+        if (stateful) {
+            stateful_nodes.insert(node);
+        }
+    }
+}
+
+bool EagerNodeTreeExecutor::is_frame_cacheable(Node* node) const
+{
+    // Storage may have been created by the execution that just ran
+    return frame_cache_enabled && current_frame &&
+           time_dependent_nodes.contains(node) &&
+           !stateful_nodes.contains(node) && !holds_state(node);
+}
+
+bool EagerNodeTreeExecutor::restore_frame_outputs(Node* node)
+{
+    if (!is_frame_cacheable(node)) {
+        return false;
+    }
+
+    auto frame = frame_cache.find(*current_frame);
+    if (frame == frame_cache.end()) {
+        return false;
+    }
+    auto cached = frame->second.outputs.find(node);
+    if (cached == frame->second.outputs.end()) {
+        return false;
+    }
+
+    frame->second.last_used = ++frame_cache_clock;
+
+    auto& outputs = node->get_outputs();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        auto it = index_cache.find(outputs[i]);
+        if (it == index_cache.end())
+            continue;
+        output_states[it->second].value = cached->second[i];
+        output_states[it->second].is_cached = true;
+    }
+    return true;
+}
+
+void EagerNodeTreeExecutor::store_frame_outputs(Node* node)
+{
+    if (!is_frame_cacheable(node)) {
+        return;
+    }
+
+    std::vector<entt::meta_any> values;
+    size_t bytes = 0;
+    for (auto* output : node->get_outputs()) {
+        auto it = index_cache.find(output);
+        if (it == index_cache.end()) {
+            values.emplace_back();
+            continue;
+        }
+        auto& value = output_states[it->second].value;
+        bytes += estimate_value_size(value);
+        values.push_back(value);
+    }
+
+    auto [frame, inserted] = frame_cache.try_emplace(*current_frame);
+    if (frame->second.bytes + bytes > frame_cache_budget) {
+        if (inserted)
+            frame_cache.erase(frame);
+        return;
+    }
+    frame->second.bytes += bytes;
+    frame->second.last_used = ++frame_cache_clock;
+    frame->second.outputs[node] = std::move(values);
+
+    if (inserted && frame_cache_max_frames &&
+        frame_cache.size() > frame_cache_max_frames) {
+        auto oldest = std::min_element(
+            frame_cache.begin(),
+            frame_cache.end(),
+            [](const auto& a, const auto& b) {
+                return a.second.last_used < b.second.last_used;
+            });
+        frame_cache.erase(oldest);
+    }
+}
+
+bool EagerNodeTreeExecutor::restore_quality_outputs(Node* node)
+{
+    if (!quality_dependent_nodes.contains(node) ||
+        always_dirty_cone.contains(node)) {
+        return false;
+    }
+    auto outputs_of_quality = quality_cache.find(quality);
+    if (outputs_of_quality == quality_cache.end()) {
+        return false;
+    }
+    auto cached = outputs_of_quality->second.find(node);
+    if (cached == outputs_of_quality->second.end()) {
+        return false;
+    }
+
+    auto& outputs = node->get_outputs();
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        auto it = index_cache.find(outputs[i]);
+        if (it == index_cache.end())
+            continue;
+        output_states[it->second].value = cached->second[i];
+        output_states[it->second].is_cached = true;
+    }
+    for (auto* input : node->get_inputs()) {
+        auto it = index_cache.find(input);
+        if (it != index_cache.end())
+            input_states[it->second].is_cached = true;
+    }
+    return true;
+}
+
+void EagerNodeTreeExecutor::store_quality_outputs(Node* node)
+{
+    bool dependent = quality_readers.contains(node);
+    for (auto* input : node->get_inputs()) {
+        for (auto* upstream : input->directly_linked_sockets) {
+            dependent =
+                dependent || quality_dependent_nodes.contains(upstream->node);
+        }
+    }
+    if (!dependent) {
+        quality_dependent_nodes.erase(node);
+        return;
+    }
+    quality_dependent_nodes.insert(node);
+    if (always_dirty_cone.contains(node)) {
+        return;
+    }
+
+    std::vector<entt::meta_any> values;
+    for (auto* output : node->get_outputs()) {
+        auto it = index_cache.find(output);
+        if (it == index_cache.end()) {
+            values.emplace_back();
+            continue;
+        }
+        values.push_back(output_states[it->second].value);
+    }
+    quality_cache[quality][node] = std::move(values);
+}
+
 RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,278 @@
+#include "nodes/core/node_exec_pipelined.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include "nodes/core/api.hpp"
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "spdlog/spdlog.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+PipelinedTreeExecutor::PipelinedTreeExecutor(
+    NodeTree* tree,
+    std::vector<NodeSocket*> outputs,
+    size_t max_in_flight)
+    : outputs(std::move(outputs))
+{
+    compile(tree);
+
+    if (max_in_flight == 0)
+        max_in_flight = std::max<size_t>(stages.size(), 1);
+    for (size_t i = 0; i < max_in_flight; ++i) {
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->values.resize(socket_index.size());
+        slots.back()->provided.resize(socket_index.size());
+        free_slots.push_back(slots.back().get());
+    }
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+        stages[i]->host = create_node_tree_executor({});
+        stages[i]->thread =
+            std::thread(&PipelinedTreeExecutor::stage_loop, this, i);
+    }
+}
+
+PipelinedTreeExecutor::~PipelinedTreeExecutor()
+{
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this] { return in_flight == 0; });
+        stopping = true;
+    }
+    changed.notify_all();
+    for (auto& stage : stages) {
+        stage->thread.join();
+    }
+}
+
+void PipelinedTreeExecutor::compile(NodeTree* tree)
+{
+    tree->ensure_topology_cache();
+
+    // The nodes the outputs depend on
+    std::set<Node*> required;
+    std::vector<Node*> to_visit;
+    for (auto* output : outputs) {
+        to_visit.push_back(output->node);
+    }
+    while (!to_visit.empty()) {
+        auto node = to_visit.back();
+        to_visit.pop_back();
+        if (!required.insert(node).second)
+            continue;
+        for (auto* input : node->get_inputs()) {
+            for (auto* linked : input->directly_linked_sockets) {
+                to_visit.push_back(linked->node);
+            }
+        }
+    }
+
+    // A node's stage is one past the last stage of its upstream
+    std::unordered_map<Node*, size_t> levels;
+    for (auto* node : tree->get_toposort_left_to_right()) {
+        if (!required.count(node))
+            continue;
+        size_t level = 0;
+        for (auto* input : node->get_inputs()) {
+            for (auto* linked : input->directly_linked_sockets) {
+                level = std::max(level, levels[linked->node] + 1);
+            }
+        }
+        levels[node] = level;
+        while (stages.size() <= level) {
+            stages.push_back(std::make_unique<Stage>());
+        }
+        stages[level]->nodes.push_back(node);
+
+        for (auto* input : node->get_inputs()) {
+            socket_index.emplace(input, socket_index.size());
+        }
+        for (auto* output : node->get_outputs()) {
+            socket_index.emplace(output, socket_index.size());
+        }
+    }
+}
+
+uint64_t PipelinedTreeExecutor::submit(Frame frame)
+{
+    Slot* slot;
+    {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [this] { return !free_slots.empty(); });
+        slot = free_slots.back();
+        free_slots.pop_back();
+        slot->frame = ++frames_submitted;
+        in_flight++;
+    }
+
+    slot->global_payload = std::move(frame.global_payload);
+    for (auto& [socket, value] : frame.inputs) {
+        auto it = socket_index.find(socket);
+        if (it == socket_index.end()) {
+            // Not needed by the outputs
+            continue;
+        }
+        slot->values[it->second] = std::move(value);
+        slot->provided[it->second] = true;
+    }
+    auto number = slot->frame;
+
+    std::lock_guard lock(mutex);
+    if (stages.empty()) {
+        complete(slot);
+    }
+    else {
+        stages.front()->queue.push_back(slot);
+    }
+    changed.notify_all();
+    return number;
+}
+
+std::shared_ptr<const ResultSnapshot> PipelinedTreeExecutor::next_result()
+{
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this] { return !results.empty() || in_flight == 0; });
+    if (results.empty()) {
+        return nullptr;
+    }
+    auto result = std::move(results.front());
+    results.pop_front();
+    return result;
+}
+
+size_t PipelinedTreeExecutor::stage_count() const
+{
+    return stages.size();
+}
+
+void PipelinedTreeExecutor::stage_loop(size_t index)
+{
+    auto& stage = *stages[index];
+    while (true) {
+        Slot* slot;
+        {
+            std::unique_lock lock(mutex);
+            changed.wait(
+                lock, [&] { return stopping || !stage.queue.empty(); });
+            if (stage.queue.empty()) {
+                return;
+            }
+            slot = stage.queue.front();
+            stage.queue.pop_front();
+        }
+
+        for (auto* node : stage.nodes) {
+            run_node(node, *slot, stage.host.get());
+        }
+
+        // Stages take frames in order, so frames complete in order
+        {
+            std::lock_guard lock(mutex);
+            if (index + 1 < stages.size()) {
+                stages[index + 1]->queue.push_back(slot);
+            }
+            else {
+                complete(slot);
+            }
+        }
+        changed.notify_all();
+    }
+}
+
+void PipelinedTreeExecutor::run_node(
+    Node* node,
+    Slot& slot,
+    NodeTreeExecutor* host)
+{
+    ExeParams params{ *node, slot.global_payload };
+    bool missing_input = false;
+    for (auto* input : node->get_inputs()) {
+        if (input->is_placeholder()) {
+            continue;
+        }
+        auto index = socket_index.at(input);
+        auto& value = slot.values[index];
+        // Unless given with the frame
+        if (!slot.provided[index]) {
+            if (!input->directly_linked_sockets.empty()) {
+                // Lazy inputs are evaluated eagerly, upstream is an earlier
+                // stage
+                auto upstream = input->directly_linked_sockets[0];
+                value = slot.values[socket_index.at(upstream)];
+            }
+            else if (input->dataField.value) {
+                value = input->dataField.value;
+            }
+        }
+
+        if (!value && input->optional) {
+            params.inputs_.push_back(nullptr);
+            continue;
+        }
+        missing_input = missing_input || !value;
+        params.inputs_.push_back(&value);
+    }
+    for (auto* output : node->get_outputs()) {
+        auto& value = slot.values[socket_index.at(output)];
+        value = {};
+        params.outputs_.push_back(&value);
+    }
+    if (missing_input) {
+        // Downstream sees its inputs missing in turn
+        return;
+    }
+    params.executor = host;
+    if (node->is_node_group())
+        params.subtree = static_cast<NodeGroup*>(node)->get_sub_tree();
+
+    std::unique_lock exclusive(exclusive_mutex, std::defer_lock);
+    if (!node->typeinfo->THREAD_SAFE)
+        exclusive.lock();
+    try {
+        if (!node->typeinfo->node_execute(params)) {
+            node->execution_failed = "Execution failed";
+        }
+        else {
+            node->execution_failed = {};
+            return;
+        }
+    }
+    catch (const std::exception& e) {
+        node->execution_failed = e.what();
+        spdlog::error(
+            "Node {} failed on frame {}: {}",
+            node->ui_name,
+            slot.frame,
+            e.what());
+    }
+    for (auto* value : params.outputs_) {
+        *value = {};
+    }
+}
+
+void PipelinedTreeExecutor::complete(Slot* slot)
+{
+    auto snapshot = std::make_shared<ResultSnapshot>();
+    snapshot->epoch = slot->frame;
+    for (auto* output : outputs) {
+        auto& value = slot->values[socket_index.at(output)];
+        if (value) {
+            snapshot->values[output->ID.Get()] =
+                std::make_shared<const entt::meta_any>(std::move(value));
+        }
+    }
+    results.push_back(std::move(snapshot));
+
+    for (auto& value : slot->values) {
+        value = {};
+    }
+    std::fill(slot->provided.begin(), slot->provided.end(), false);
+    slot->global_payload = {};
+    free_slots.push_back(slot);
+    in_flight--;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
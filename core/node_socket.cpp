@@ -1,3 +1,5 @@
+#include <atomic>
+
 #include <spdlog/spdlog.h>
 
 #include "nodes/core/api.h"
@@ -69,6 +71,8 @@ void NodeSocket::Serialize(nlohmann::json& value)
     socket["ui_name"] = ui_name;
     socket["in_out"] = in_out;
     socket["optional"] = optional;
+    if (lazy)
+        socket["lazy"] = lazy;
 
     if (dataField.value) {
         switch (type_info.id()) {
@@ -121,7 +125,7 @@ void NodeSocket::Serialize(nlohmann::json& value)
     }
 }
 
-void NodeSocket::DeserializeInfo(nlohmann::json& socket_json)
+void NodeSocket::DeserializeInfo(const nlohmann::json& socket_json)
 {
     ID = socket_json["ID"].get<unsigned>();
 
@@ -133,6 +137,9 @@ void NodeSocket::DeserializeInfo(nlohmann::json& socket_json)
     if (socket_json.find("optional") != socket_json.end()) {
         optional = socket_json["optional"].get<bool>();
     }
+    if (socket_json.find("lazy") != socket_json.end()) {
+        lazy = socket_json["lazy"].get<bool>();
+    }
     if (socket_json.find("socket_group_identifier") != socket_json.end()) {
         socket_group_identifier =
             socket_json["socket_group_identifier"].get<std::string>();
@@ -199,10 +206,20 @@ void NodeSocket::DeserializeValue(const nlohmann::json& value)
 
                     break;
             }
+            mark_default_changed();
         }
     }
 }
 
+// One clock for all sockets: a socket allocated where a deleted one lived
+// never sees a version the executor still holds for the old one.
+static std::atomic<uint64_t> default_value_clock{ 0 };
+
+void NodeSocket::mark_default_changed()
+{
+    dataField.version = ++default_value_clock;
+}
+
 NodeSocket* SocketGroup::add_socket(
     const char* type_name,
     const char* socket_identifier,
@@ -2,15 +2,19 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <iostream>
+#include <map>
 #include <set>
 #include <sstream>
 #include <stack>
 #include <unordered_set>
 
+#include "nodes/core/diagnostics.hpp"
 #include "nodes/core/io/json.hpp"
 #include "nodes/core/node.hpp"
 #include "nodes/core/node_link.hpp"
+#include "nodes/core/worker_pool.hpp"
 
 // Macro for Not implemented with file and line number
 #define NOT_IMPLEMENTED()                                               \
@@ -21,10 +25,6 @@
     } while (0)
 
 RUZINO_NAMESPACE_OPEN_SCOPE
-struct NodeGroupStorage {
-    std::shared_ptr<NodeTreeExecutor> executor = nullptr;
-    static constexpr bool has_storage = false;
-};
 
 NodeTreeDescriptor::NodeTreeDescriptor()
 {
@@ -46,6 +46,9 @@ NodeTreeDescriptor::NodeTreeDescriptor()
 
                 auto input_group = params.get_input_group(OutsideInputsPH);
 
+                // Reading it registers the group as a quality reader, so
+                // a quality change runs the group again
+                group_storage.executor->set_quality(params.get_quality());
                 group_storage.executor->prepare_tree(subtree);
 
                 auto [input_node, output_node] = [subtree]() {
@@ -118,11 +121,46 @@ NodeTreeDescriptor::NodeTreeDescriptor()
             .set_execution_function([](ExeParams params) { return true; })
             .set_always_required(true));
 
+    // For-each zone, the two nodes paired through Node::paired_node. The
+    // executor runs the nodes between them once per element, see
+    // EagerNodeTreeExecutor::run_foreach_zone().
+    register_node(
+        NodeTypeInfo(FOREACH_BEGIN_IDENTIFIER)
+            .set_ui_name("For Each")
+            .set_declare_function([](NodeDeclarationBuilder& b) {
+                b.add_input<std::vector<entt::meta_any>>("Elements");
+                b.add_output<entt::meta_any>("Element");
+                b.add_output<int>("Index");
+                // Values the body reads unchanged by every element
+                b.add_input_group("Captured");
+                b.add_output_group("Captured");
+            })
+            .set_execution_function([](ExeParams params) { return true; }));
+
+    register_node(
+        NodeTypeInfo(FOREACH_END_IDENTIFIER)
+            .set_ui_name("For Each End")
+            .set_declare_function([](NodeDeclarationBuilder& b) {
+                b.add_input<entt::meta_any>("Result");
+                b.add_output<std::vector<entt::meta_any>>("Results");
+                // The captured values, passed on
+                b.add_output_group("Captured");
+            })
+            .set_execution_function([](ExeParams params) {
+                params.set_error("For-each zone without a paired begin");
+                return false;
+            }));
+
     add_socket_group_syncronization(
         { { "simulation_in", "Simulation In", PinKind::Input },
           { "simulation_in", "Simulation Out", PinKind::Output },
           { "simulation_out", "Simulation In", PinKind::Input },
           { "simulation_out", "Simulation Out", PinKind::Output } });
+
+    add_socket_group_syncronization(
+        { { FOREACH_BEGIN_IDENTIFIER, "Captured", PinKind::Input },
+          { FOREACH_BEGIN_IDENTIFIER, "Captured", PinKind::Output },
+          { FOREACH_END_IDENTIFIER, "Captured", PinKind::Output } });
 }
 
 NodeTreeDescriptor::~NodeTreeDescriptor()
@@ -265,6 +303,16 @@ void NodeTree::set_ui_settings(const std::string& settings)
     ui_settings = settings;
 }
 
+uint64_t NodeTree::structure_version() const
+{
+    return structure_version_;
+}
+
+void NodeTree::bump_structure_version()
+{
+    structure_version_++;
+}
+
 void NodeTree::SetDirty(bool dirty)
 {
     this->dirty_ = dirty;
@@ -319,6 +367,7 @@ std::string NodeTree::print_tree_structure() const
 
 void NodeTree::clear()
 {
+    bump_structure_version();
     links.clear();
     sockets.clear();
     nodes.clear();
@@ -392,6 +441,7 @@ Node* NodeTree::add_node(const char* idname)
     auto node = std::make_unique<Node>(this, idname);
     auto bare = node.get();
     nodes.push_back(std::move(node));
+    bump_structure_version();
     bare->refresh_node();
     return bare;
 }
@@ -450,6 +500,7 @@ NodeTree& NodeTree::merge(NodeTree&& other)
         sockets.end(),
         std::make_move_iterator(other.sockets.begin()),
         std::make_move_iterator(other.sockets.end()));
+    bump_structure_version();
     ensure_topology_cache();
     return *this;
 }
@@ -501,6 +552,7 @@ static NodeGroup* create_group_node(NodeTree* tree)
 {
     NodeGroup* node = new NodeGroup(tree, NODE_GROUP_IDENTIFIER);
     tree->nodes.push_back(std::unique_ptr<Node>(node));
+    tree->bump_structure_version();
     return node;
 }
 
@@ -508,6 +560,7 @@ static Node* create_group_node_in(NodeTree* tree)
 {
     Node* node = new Node(tree, NODE_GROUP_IN_IDENTIFIER);
     tree->nodes.push_back(std::unique_ptr<Node>(node));
+    tree->bump_structure_version();
     return node;
 }
 
@@ -515,6 +568,7 @@ static Node* create_group_node_out(NodeTree* tree)
 {
     Node* node = new Node(tree, NODE_GROUP_OUT_IDENTIFIER);
     tree->nodes.push_back(std::unique_ptr<Node>(node));
+    tree->bump_structure_version();
     return node;
 }
 
@@ -646,6 +700,7 @@ void NodeTree::ungroup(Node* node)
     assert(node->typeinfo->id_name == NODE_GROUP_IDENTIFIER);
 
     NodeGroup* group = static_cast<NodeGroup*>(node);
+    group->materialize_sub_tree();
 
     spdlog::info(
         "Ungrouping node ID={}, group_in={}, group_out={}",
@@ -763,6 +818,25 @@ void NodeTree::ungroup(Node* node)
     ensure_topology_cache();
 }
 
+void NodeTree::materialize_sub_trees(bool recursive)
+{
+    std::vector<NodeGroup*> groups;
+    for (auto& node : nodes) {
+        if (node->is_node_group()) {
+            groups.push_back(static_cast<NodeGroup*>(node.get()));
+        }
+    }
+    if (groups.empty())
+        return;
+
+    WorkerPool::instance().parallel_for(
+        groups.size(), [&groups, recursive](size_t i) {
+            auto sub_tree = groups[i]->get_sub_tree();
+            if (recursive)
+                sub_tree->materialize_sub_trees(true);
+        });
+}
+
 unsigned NodeTree::UniqueID()
 {
     while (used_ids.find(current_id) != used_ids.end()) {
@@ -779,6 +853,7 @@ NodeLink* NodeTree::add_link(
     bool refresh_topology)
 {
     SetDirty(true);
+    bump_structure_version();
 
     auto fromnode = fromsock->node;
     auto tonode = tosock->node;
@@ -885,6 +960,7 @@ void NodeTree::delete_link(
     bool remove_from_group)
 {
     SetDirty(true);
+    bump_structure_version();
 
     auto link = std::find_if(links.begin(), links.end(), [linkId](auto& link) {
         if (link->fromLink)
@@ -962,11 +1038,6 @@ void NodeTree::delete_node(Node* nodeId, bool allow_repeat_delete)
 
 void NodeTree::delete_node(NodeId nodeId, bool allow_repeat_delete)
 {
-    spdlog::info(
-        "delete_node called with NodeId={}, allow_repeat={}",
-        nodeId.Get(),
-        allow_repeat_delete);
-
     auto id = std::find_if(nodes.begin(), nodes.end(), [nodeId](auto&& node) {
         return node->ID == nodeId;
     });
@@ -974,11 +1045,6 @@ void NodeTree::delete_node(NodeId nodeId, bool allow_repeat_delete)
     if (id != nodes.end()) {
         auto node = id->get();
 
-        spdlog::info(
-            "Found node to delete: ID={}, type={}",
-            node->ID.Get(),
-            node->typeinfo->id_name);
-
         auto paired = node->paired_node;
         if (paired)
             paired->paired_node = nullptr;
@@ -997,8 +1063,9 @@ void NodeTree::delete_node(NodeId nodeId, bool allow_repeat_delete)
             });
 
         nodes.erase(new_iter);
+        bump_structure_version();
 
-        spdlog::info("Node deleted successfully");
+        diagnose<DiagnosticCode::NodeDeleted>(this, nodeId.Get());
 
         if (paired) {
             delete_node(paired, true);
@@ -1009,9 +1076,7 @@ void NodeTree::delete_node(NodeId nodeId, bool allow_repeat_delete)
         throw std::runtime_error("Node not found when deleting.");
     }
     else {
-        spdlog::warn(
-            "Node not found but allow_repeat_delete=true: NodeId={}",
-            nodeId.Get());
+        diagnose<DiagnosticCode::NodeAlreadyDeleted>(this, nodeId.Get());
     }
 
     ensure_topology_cache();
@@ -1085,6 +1150,7 @@ void NodeTree::delete_socket(SocketID socketId, bool force_group_delete)
     if (force_group_delete || !socket_in_group)
         if (id != sockets.end()) {
             sockets.erase(id);
+            bump_structure_version();
         }
 }
 
@@ -1351,36 +1417,56 @@ void NodeTree::deserialize(const std::string& str)
     nlohmann::json value;
     std::istringstream in(str);
     in >> value;
+    deserialize(value);
+}
+
+// Missing sections of a serialized tree read as empty.
+static const nlohmann::json& json_section(
+    const nlohmann::json& value,
+    const char* key)
+{
+    static const nlohmann::json empty;
+    auto found = value.find(key);
+    return found != value.end() ? *found : empty;
+}
+
+void NodeTree::deserialize(const nlohmann::json& value)
+{
     clear();
 
+    const auto& sockets_info = json_section(value, "sockets_info");
+    const auto& nodes_info = json_section(value, "nodes_info");
+    const auto& links_info = json_section(value, "links_info");
+
     // To avoid reuse of ID, push up the ID in the beginning
 
-    for (auto&& socket_json : value["sockets_info"]) {
+    for (auto&& socket_json : sockets_info) {
         used_ids.emplace(socket_json["ID"]);
     }
 
-    for (auto&& node_json : value["nodes_info"]) {
+    for (auto&& node_json : nodes_info) {
         // only add if it has "ID" domain
         if (node_json.contains("ID")) {
             used_ids.emplace(node_json["ID"]);
         }
     }
 
-    for (auto&& link_json : value["links_info"]) {
+    for (auto&& link_json : links_info) {
         used_ids.emplace(link_json["ID"]);
     }
 
-    for (auto&& socket_json : value["sockets_info"]) {
+    for (auto&& socket_json : sockets_info) {
         auto socket = std::make_unique<NodeSocket>();
         socket->DeserializeInfo(socket_json);
         sockets.push_back(std::move(socket));
     }
 
-    for (auto&& node_json : value["nodes_info"]) {
+    std::map<std::string, std::shared_ptr<SubTreeSource>> sub_tree_sources;
+    for (auto&& node_json : nodes_info) {
         if (node_json.contains("ID")) {
             auto id = node_json["ID"].get<unsigned>();
             auto id_name = node_json["id_name"].get<std::string>();
-            auto storage_info = node_json["storage_info"];
+            auto storage_info = json_section(node_json, "storage_info");
 
             std::unique_ptr<Node> node;
 
@@ -1388,8 +1474,17 @@ void NodeTree::deserialize(const std::string& str)
                 node = std::make_unique<NodeGroup>(this, id, id_name.c_str());
                 NodeGroup* group = static_cast<NodeGroup*>(node.get());
 
-                group->sub_tree->deserialize(
-                    value["nodes_info"]["sub_trees"][node_json["subtree"]]);
+                // Only the interface sockets are built now, the subtree is
+                // decoded on first use. Groups with the same key share it.
+                auto key = node_json["subtree"].get<std::string>();
+                auto& source = sub_tree_sources[key];
+                if (!source) {
+                    source = std::make_shared<SubTreeSource>();
+                    source->serialized =
+                        nodes_info["sub_trees"][key]
+                            .get<std::string>();
+                }
+                group->set_pending_sub_tree(source);
             }
             else {
                 if (descriptor_->get_node_type(id_name.c_str()))
@@ -1408,12 +1503,12 @@ void NodeTree::deserialize(const std::string& str)
 
     // Get the saved value in the sockets
     for (auto&& node_socket : sockets) {
-        const auto& socket_value =
-            value["sockets_info"][std::to_string(node_socket->ID.Get())];
+        const auto& socket_value = json_section(
+            sockets_info, std::to_string(node_socket->ID.Get()).c_str());
         node_socket->DeserializeValue(socket_value);
     }
 
-    for (auto&& link_json : value["links_info"]) {
+    for (auto&& link_json : links_info) {
         add_link(
             link_json["StartPinID"].get<unsigned>(),
             link_json["EndPinID"].get<unsigned>());
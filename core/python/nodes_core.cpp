@@ -5,6 +5,7 @@
 
 #include <entt/meta/meta.hpp>
 
+#include "nodes/core/diagnostics.hpp"
 #include "nodes/core/math/vec.hpp"
 #include "nodes/core/node_exec_python.hpp"
 #include "nodes/core/node_link.hpp"
@@ -176,6 +177,7 @@ NB_MODULE(nodes_core_py, m)
                         throw std::runtime_error(
                             "Unsupported vector size (expected 2 or 3)");
                     }
+                    s.mark_default_changed();
                     return;
                 }
                 // Scalar types
@@ -197,6 +199,7 @@ NB_MODULE(nodes_core_py, m)
                         "Unsupported type for socket default value");
                 }
                 s.dataField.value = value;
+                s.mark_default_changed();
             },
             nb::arg("value"),
             "Set the default value of this socket");
@@ -502,6 +505,26 @@ NB_MODULE(nodes_core_py, m)
         nb::arg("required_node") = nullptr,
         "Generate Python code with custom options");
 
+    m.def(
+        "diagnostics",
+        [](NodeTree* tree) {
+            std::vector<std::string> messages;
+            for (auto& diagnostic : Ruzino::diagnostics().snapshot()) {
+                if (tree && diagnostic.tree && diagnostic.tree != tree)
+                    continue;
+                messages.push_back(
+                    Ruzino::diagnostics().format(diagnostic, tree));
+            }
+            return messages;
+        },
+        nb::arg("tree") = nullptr,
+        "Formatted executor and editing diagnostics, oldest first. Given a "
+        "tree, only its diagnostics are listed, with names resolved");
+    m.def(
+        "clear_diagnostics",
+        []() { Ruzino::diagnostics().clear(); },
+        "Drop all recorded diagnostics");
+
     // Helper functions
     m.def("create_descriptor", []() {
         return std::make_shared<NodeTreeDescriptor>();
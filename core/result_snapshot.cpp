@@ -0,0 +1,50 @@
+#include "nodes/core/result_snapshot.hpp"
+
+#include "nodes/core/socket.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+const entt::meta_any* ResultSnapshot::find(NodeSocket* socket) const
+{
+    auto it = values.find(socket->ID.Get());
+    if (it == values.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+void ResultPublisher::subscribe(NodeSocket* socket)
+{
+    std::lock_guard lock(subscriptions_mutex_);
+    subscriptions_.insert(socket->ID.Get());
+}
+
+void ResultPublisher::unsubscribe(NodeSocket* socket)
+{
+    std::lock_guard lock(subscriptions_mutex_);
+    subscriptions_.erase(socket->ID.Get());
+}
+
+std::vector<unsigned> ResultPublisher::subscriptions() const
+{
+    std::lock_guard lock(subscriptions_mutex_);
+    return { subscriptions_.begin(), subscriptions_.end() };
+}
+
+std::shared_ptr<const ResultSnapshot> ResultPublisher::latest() const
+{
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+uint64_t ResultPublisher::epoch() const
+{
+    auto snapshot = latest();
+    return snapshot ? snapshot->epoch : 0;
+}
+
+void ResultPublisher::publish(std::shared_ptr<const ResultSnapshot> snapshot)
+{
+    snapshot_.store(std::move(snapshot), std::memory_order_release);
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,320 @@
+#include "nodes/core/simulation_checkpoint.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "nodes/core/value_serializer.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+static constexpr char checkpoint_magic[8] = { 'R', 'Z', 'C', 'K',
+                                               'P', 'T', '0', '1' };
+
+nlohmann::json capture_simulation_state(NodeTree* tree)
+{
+    nlohmann::json state = nlohmann::json::object();
+
+    for (auto& node : tree->nodes) {
+        if (node->is_node_group()) {
+            auto group = static_cast<NodeGroup*>(node.get());
+            // A subtree that was never decoded has never run either.
+            if (!group->is_sub_tree_materialized())
+                continue;
+            auto sub_state = capture_simulation_state(group->get_sub_tree());
+            if (!sub_state.empty())
+                state["groups"][std::to_string(node->ID.Get())] =
+                    std::move(sub_state);
+            continue;
+        }
+
+        if (std::string(node->typeinfo->id_name) != "simulation_in" ||
+            !node->storage)
+            continue;
+
+        nlohmann::json value;
+        if (!serialize_value(node->storage, value)) {
+            spdlog::warn(
+                "No value serializer for storage type {} of node {}, it is "
+                "not checkpointed",
+                node->storage.type().info().name(),
+                node->ID.Get());
+            continue;
+        }
+        auto& entry = state["nodes"][std::to_string(node->ID.Get())];
+        // The type name hashes to the same id in every build, unlike an id
+        // that depends on how the writing binary was compiled.
+        entry["type"] = get_type_name(node->storage.type());
+        entry["value"] = std::move(value);
+    }
+    return state;
+}
+
+bool restore_simulation_state(
+    NodeTree* tree,
+    const nlohmann::json& state,
+    NodeTreeExecutor* executor)
+{
+    bool all_restored = true;
+
+    if (state.contains("nodes")) {
+        for (auto& [id, entry] : state["nodes"].items()) {
+            auto node = tree->find_node(NodeId(std::stoul(id)));
+            if (!node) {
+                spdlog::warn("Checkpointed node {} no longer exists", id);
+                all_restored = false;
+                continue;
+            }
+            const auto& type_name =
+                entry["type"].get_ref<const std::string&>();
+            entt::meta_any storage;
+            if (!deserialize_value(
+                    entt::hashed_string{ type_name.c_str() }.value(),
+                    entry["value"],
+                    storage)) {
+                spdlog::warn("No value serializer for storage of node {}", id);
+                all_restored = false;
+                continue;
+            }
+            node->storage = std::move(storage);
+            if (executor)
+                executor->notify_node_dirty(node);
+        }
+    }
+
+    if (state.contains("groups")) {
+        for (auto& [id, sub_state] : state["groups"].items()) {
+            auto node = tree->find_node(NodeId(std::stoul(id)));
+            if (!node || !node->is_node_group()) {
+                all_restored = false;
+                continue;
+            }
+            // Group subtrees run on their own executor, which picks the
+            // storage up on its next run.
+            all_restored &= restore_simulation_state(
+                static_cast<NodeGroup*>(node)->get_sub_tree(), sub_state);
+            if (executor)
+                executor->notify_node_dirty(node);
+        }
+    }
+    return all_restored;
+}
+
+SimulationCheckpointFile::SimulationCheckpointFile(std::filesystem::path path)
+    : path_(std::move(path))
+{
+    bool existing = std::filesystem::exists(path_) &&
+                    std::filesystem::file_size(path_) > 0;
+    if (existing) {
+        // A torn chunk is cut off, chunks appended after it would otherwise
+        // be read as its payload.
+        auto end = scan_index();
+        if (end < static_cast<std::streamoff>(
+                      std::filesystem::file_size(path_)))
+            std::filesystem::resize_file(path_, end);
+    }
+
+    out_.open(path_, std::ios::binary | std::ios::app);
+    if (!out_) {
+        throw std::runtime_error(
+            "Cannot open checkpoint file " + path_.string());
+    }
+    if (!existing) {
+        out_.write(checkpoint_magic, sizeof(checkpoint_magic));
+        out_.flush();
+    }
+
+    writer_ = std::thread(&SimulationCheckpointFile::writer_loop, this);
+}
+
+SimulationCheckpointFile::~SimulationCheckpointFile()
+{
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    queue_changed_.notify_all();
+    writer_.join();
+}
+
+std::streamoff SimulationCheckpointFile::scan_index()
+{
+    std::ifstream in(path_, std::ios::binary);
+    char magic[sizeof(checkpoint_magic)];
+    in.read(magic, sizeof(magic));
+    if (!in || !std::equal(magic, magic + sizeof(magic), checkpoint_magic)) {
+        throw std::runtime_error(
+            path_.string() + " is not a simulation checkpoint file");
+    }
+
+    auto file_size = static_cast<std::streamoff>(
+        std::filesystem::file_size(path_));
+    std::streamoff end = sizeof(checkpoint_magic);
+    while (true) {
+        int64_t frame;
+        uint64_t size;
+        in.read(reinterpret_cast<char*>(&frame), sizeof(frame));
+        in.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!in)
+            break;
+        auto offset = static_cast<std::streamoff>(in.tellg());
+        if (offset + static_cast<std::streamoff>(size) > file_size) {
+            spdlog::warn(
+                "Checkpoint {} ends with a truncated chunk for frame {}",
+                path_.string(),
+                frame);
+            break;
+        }
+        index_[frame] = { offset, size };
+        in.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+        end = offset + static_cast<std::streamoff>(size);
+    }
+    return end;
+}
+
+bool SimulationCheckpointFile::append_chunk(
+    int64_t frame,
+    const std::vector<uint8_t>& payload)
+{
+    uint64_t size = payload.size();
+    auto start = static_cast<std::streamoff>(out_.tellp());
+    out_.write(reinterpret_cast<const char*>(&frame), sizeof(frame));
+    out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    auto offset = static_cast<std::streamoff>(out_.tellp());
+    out_.write(reinterpret_cast<const char*>(payload.data()), size);
+    out_.flush();
+
+    if (!out_.good()) {
+        spdlog::error(
+            "Failed to write frame {} to checkpoint {}",
+            frame,
+            path_.string());
+        // Cut the partial chunk off, it would hide every later chunk from
+        // scan_index().
+        out_.close();
+        std::error_code error;
+        if (start >= 0)
+            std::filesystem::resize_file(path_, start, error);
+        out_.open(path_, std::ios::binary | std::ios::app);
+        return false;
+    }
+
+    std::lock_guard lock(mutex_);
+    index_[frame] = { offset, size };
+    return true;
+}
+
+void SimulationCheckpointFile::writer_loop()
+{
+    std::unique_lock lock(mutex_);
+    while (true) {
+        queue_changed_.wait(
+            lock, [this] { return stopping_ || !queue_.empty(); });
+        if (queue_.empty())
+            break;
+
+        auto [frame, state] = std::move(queue_.front());
+        queue_.pop_front();
+        writing_ = true;
+        lock.unlock();
+
+        bool written = append_chunk(frame, nlohmann::json::to_cbor(state));
+
+        lock.lock();
+        write_failed_ |= !written;
+        writing_ = false;
+        queue_changed_.notify_all();
+    }
+}
+
+void SimulationCheckpointFile::write_frame_async(
+    int64_t frame,
+    nlohmann::json state)
+{
+    {
+        std::lock_guard lock(mutex_);
+        queue_.emplace_back(frame, std::move(state));
+    }
+    queue_changed_.notify_all();
+}
+
+bool SimulationCheckpointFile::write_frame(
+    int64_t frame,
+    const nlohmann::json& state)
+{
+    write_frame_async(frame, state);
+    return flush();
+}
+
+bool SimulationCheckpointFile::flush()
+{
+    std::unique_lock lock(mutex_);
+    queue_changed_.wait(lock, [this] { return queue_.empty() && !writing_; });
+    return !std::exchange(write_failed_, false);
+}
+
+bool SimulationCheckpointFile::read_frame(int64_t frame, nlohmann::json& state)
+{
+    ChunkLocation location;
+    {
+        std::unique_lock lock(mutex_);
+        // Frames still in the queue are newer than anything on disk.
+        for (auto it = queue_.rbegin(); it != queue_.rend(); ++it) {
+            if (it->first == frame) {
+                state = it->second;
+                return true;
+            }
+        }
+        // The chunk being written is neither queued nor indexed yet.
+        queue_changed_.wait(lock, [this] { return !writing_; });
+
+        auto it = index_.find(frame);
+        if (it == index_.end())
+            return false;
+        location = it->second;
+    }
+
+    std::ifstream in(path_, std::ios::binary);
+    in.seekg(location.offset);
+    std::vector<uint8_t> payload(location.size);
+    in.read(reinterpret_cast<char*>(payload.data()), location.size);
+    if (!in) {
+        spdlog::error(
+            "Failed to read frame {} from checkpoint {}",
+            frame,
+            path_.string());
+        return false;
+    }
+    state = nlohmann::json::from_cbor(payload);
+    return true;
+}
+
+bool SimulationCheckpointFile::has_frame(int64_t frame)
+{
+    std::lock_guard lock(mutex_);
+    if (index_.contains(frame))
+        return true;
+    return std::any_of(queue_.begin(), queue_.end(), [frame](auto& entry) {
+        return entry.first == frame;
+    });
+}
+
+std::vector<int64_t> SimulationCheckpointFile::frames()
+{
+    std::lock_guard lock(mutex_);
+    std::set<int64_t> result;
+    for (auto& [frame, location] : index_) {
+        result.insert(frame);
+    }
+    for (auto& entry : queue_) {
+        result.insert(entry.first);
+    }
+    return { result.begin(), result.end() };
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -3,6 +3,7 @@
 #include <entt/meta/meta.hpp>
 
 #include "nodes/core/api.hpp"
+#include "nodes/core/io/json.hpp"
 #include "nodes/core/node.hpp"
 #include "nodes/core/node_tree.hpp"
 #include "spdlog/spdlog.h"
@@ -452,6 +453,135 @@ TEST_F(NodeCoreTest, NodeGroupCase2)
     ASSERT_EQ(tree->links.size(), 6);
 }
 
+TEST_F(NodeCoreTest, NodeGroupLazySubtree)
+{
+    std::shared_ptr<NodeTreeDescriptor> descriptor =
+        std::make_shared<NodeTreeDescriptor>();
+
+    NodeTypeInfo node_type_info("test_node");
+    node_type_info.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("test_socket2").min(-15).max(3).default_val(1);
+        b.add_output<int>("output");
+    });
+    descriptor->register_node(std::move(node_type_info));
+
+    auto tree = create_node_tree(descriptor);
+    std::vector<Node*> chain;
+    for (int i = 0; i < 6; ++i) {
+        chain.push_back(tree->add_node("test_node"));
+        if (i > 0)
+            tree->add_link(
+                chain[i - 1]->get_output_socket("output"),
+                chain[i]->get_input_socket("test_socket2"));
+    }
+    tree->group_up(std::vector<Node*>{ chain[1], chain[2] });
+    tree->group_up(std::vector<Node*>{ chain[4] });
+    auto serialized = tree->serialize();
+
+    auto loaded = create_node_tree(descriptor);
+    loaded->deserialize(serialized);
+    ASSERT_EQ(loaded->nodes.size(), tree->nodes.size());
+    ASSERT_EQ(loaded->links.size(), tree->links.size());
+
+    std::vector<NodeGroup*> groups;
+    for (auto& node : loaded->nodes) {
+        if (node->is_node_group()) {
+            auto group = static_cast<NodeGroup*>(node.get());
+            // Interface is available, the subtree is not decoded yet.
+            ASSERT_FALSE(group->is_sub_tree_materialized());
+            ASSERT_EQ(group->get_inputs().size(), 2);
+            ASSERT_EQ(group->get_outputs().size(), 2);
+            groups.push_back(group);
+        }
+    }
+    ASSERT_EQ(groups.size(), 2);
+
+    // Pending subtrees round-trip without being decoded.
+    auto reloaded = create_node_tree(descriptor);
+    reloaded->deserialize(loaded->serialize());
+    ASSERT_FALSE(groups[0]->is_sub_tree_materialized());
+
+    ASSERT_EQ(groups[0]->get_sub_tree()->nodes.size() +
+                  groups[1]->get_sub_tree()->nodes.size(),
+              7);
+    ASSERT_TRUE(groups[0]->is_sub_tree_materialized());
+
+    reloaded->materialize_sub_trees();
+    for (auto& node : reloaded->nodes) {
+        if (node->is_node_group()) {
+            auto group = static_cast<NodeGroup*>(node.get());
+            ASSERT_TRUE(group->is_sub_tree_materialized());
+            ASSERT_EQ(group->sub_tree->parent_node, group);
+        }
+    }
+
+    auto inner_count = groups[0]->get_sub_tree()->nodes.size() - 2;
+    loaded->ungroup(groups[0]);
+    ASSERT_EQ(loaded->nodes.size(), tree->nodes.size() - 1 + inner_count);
+}
+
+TEST_F(NodeCoreTest, NodeGroupSharedSubtree)
+{
+    std::shared_ptr<NodeTreeDescriptor> descriptor =
+        std::make_shared<NodeTreeDescriptor>();
+
+    NodeTypeInfo node_type_info("test_node");
+    node_type_info.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("test_socket2").min(-15).max(3).default_val(1);
+        b.add_output<int>("output");
+    });
+    descriptor->register_node(std::move(node_type_info));
+
+    auto tree = create_node_tree(descriptor);
+    auto node = tree->add_node("test_node");
+    auto node2 = tree->add_node("test_node");
+    tree->add_link(
+        node->get_output_socket("output"),
+        node2->get_input_socket("test_socket2"));
+    tree->group_up(std::vector<Node*>{ node2 });
+
+    // Two instances of the same group.
+    auto copy = *tree;
+    tree->merge(copy);
+
+    auto serialized = tree->serialize();
+    ASSERT_EQ(serialized, tree->serialize());
+    auto json = nlohmann::json::parse(serialized);
+    ASSERT_EQ(json["nodes_info"]["sub_trees"].size(), 1);
+
+    auto loaded = create_node_tree(descriptor);
+    loaded->deserialize(serialized);
+    ASSERT_EQ(
+        nlohmann::json::parse(loaded->serialize())["nodes_info"]["sub_trees"],
+        json["nodes_info"]["sub_trees"]);
+
+    std::vector<NodeGroup*> groups;
+    for (auto& node : loaded->nodes) {
+        if (node->is_node_group()) {
+            groups.push_back(static_cast<NodeGroup*>(node.get()));
+        }
+    }
+    ASSERT_EQ(groups.size(), 2);
+
+    loaded->materialize_sub_trees();
+
+    // The serialized form is shared, the nodes are not: each instance owns
+    // its tree, so per-node runtime state never crosses instances.
+    auto first = groups[0]->get_sub_tree();
+    auto second = groups[1]->get_sub_tree();
+    ASSERT_NE(first, second);
+    ASSERT_EQ(first->parent_node, groups[0]);
+    ASSERT_EQ(second->parent_node, groups[1]);
+    ASSERT_EQ(first->serialize(), second->serialize());
+
+    groups[0]->node_group_add_input_socket("int", "extra", "extra");
+    ASSERT_EQ(first->nodes.size(), second->nodes.size());
+    ASSERT_NE(first->serialize(), second->serialize());
+
+    loaded->ungroup(groups[1]);
+    ASSERT_EQ(groups[0]->get_sub_tree(), first);
+}
+
 TEST_F(NodeCoreTest, Inverse_Tree)
 {
     std::shared_ptr<NodeTreeDescriptor> descriptor =
@@ -1,12 +1,21 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <entt/meta/meta.hpp>
+#include <future>
+#include <map>
+#include <thread>
 
 #include "nodes/core/api.hpp"
+#include "nodes/core/diagnostics.hpp"
+#include "nodes/core/execution_recorder.hpp"
 #include "nodes/core/node.hpp"
 #include "nodes/core/node_exec_eager.hpp"
+#include "nodes/core/node_exec_pipelined.hpp"
 #include "nodes/core/node_link.hpp"
 #include "nodes/core/node_tree.hpp"
+#include "nodes/core/value_size.hpp"
 
 using namespace Ruzino;
 
@@ -211,6 +220,986 @@ TEST_F(NodeExecTest, CacheTest)
         14);  // node0: 1+2=3, node1: 3+10=13, node2: 13+1=14
 }
 
+TEST_F(NodeExecTest, ExecutionCounters)
+{
+    auto executor = create_node_tree_executor({});
+
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node0->get_input_socket("a"), 1);
+    executor->execute_tree(tree.get());
+
+    auto counters = executor->get_counters();
+    ASSERT_EQ(counters.nodes_executed, 3);
+    ASSERT_EQ(counters.nodes_skipped, 0);
+    ASSERT_EQ(counters.values_copied, 2);
+    ASSERT_EQ(counters.values_constructed, 9);
+    ASSERT_EQ(counters.persistent_cache_bytes, 9 * sizeof(int));
+
+    // Nothing changed: no executions, no copies, no new values.
+    executor->reset_counters();
+    executor->prepare_tree(tree.get());
+    executor->execute_tree(tree.get());
+    counters = executor->get_counters();
+    ASSERT_EQ(counters.nodes_executed, 0);
+    ASSERT_EQ(counters.nodes_skipped, 3);
+    ASSERT_EQ(counters.values_copied, 0);
+    ASSERT_EQ(counters.values_constructed, 0);
+    ASSERT_EQ(counters.dirty_marks, 0);
+
+    // An edit in the middle re-runs the two nodes downstream of it.
+    executor->reset_counters();
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node1->get_input_socket("b"), 5);
+    executor->execute_tree(tree.get());
+    counters = executor->get_counters();
+    ASSERT_EQ(counters.nodes_executed, 2);
+    ASSERT_EQ(counters.nodes_skipped, 1);
+    ASSERT_EQ(counters.values_copied, 1);
+    ASSERT_EQ(counters.dirty_marks, 2);
+}
+
+TEST_F(NodeExecTest, BatchedExternalSync)
+{
+    auto executor = create_node_tree_executor({});
+
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto node2 = tree->add_node("add");
+    auto separate = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+    executor->execute(tree.get());
+
+    std::vector<std::pair<NodeSocket*, entt::meta_any>> inputs;
+    inputs.emplace_back(node0->get_input_socket("b"), 5);
+    inputs.emplace_back(node1->get_input_socket("b"), 3);
+    inputs.emplace_back(separate->get_input_socket("a"), 7);
+    // Unchanged, dirties nothing
+    inputs.emplace_back(node2->get_input_socket("b"), 1);
+
+    executor->reset_counters();
+    executor->prepare_tree(tree.get());
+    executor->sync_batch_from_external_storage(inputs);
+    ASSERT_EQ(executor->get_counters().dirty_marks, 4);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 4);
+
+    // node1 keeps its own cause although it is downstream of node0
+    ASSERT_NE(
+        executor->explain_execution(node1).find("external input changed"),
+        std::string::npos);
+
+    auto values = executor->borrow_socket_values(
+        { node2->get_output_socket("result"),
+          separate->get_output_socket("result") });
+    ASSERT_EQ(values.size(), 2);
+    ASSERT_EQ(values[0]->cast<int>(), 9);  // ((0+5)+3)+1
+    ASSERT_EQ(values[1]->cast<int>(), 8);
+
+    // Sockets the executor never saw have no value
+    auto unused = tree->add_node("add");
+    values = executor->borrow_socket_values(
+        { unused->get_output_socket("result") });
+    ASSERT_EQ(values[0], nullptr);
+}
+
+TEST_F(NodeExecTest, PublishedResults)
+{
+    auto executor = create_node_tree_executor({});
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+    auto result0 = node0->get_output_socket("result");
+    auto result1 = node1->get_output_socket("result");
+
+    executor->results().subscribe(result0);
+    executor->results().subscribe(result1);
+    ASSERT_EQ(executor->results().latest(), nullptr);
+
+    executor->execute(tree.get());
+    auto first = executor->results().latest();
+    ASSERT_EQ(first->epoch, 1);
+    ASSERT_EQ(first->find(result1)->cast<int>(), 2);
+
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node1->get_input_socket("b"), 5);
+    executor->execute_tree(tree.get());
+    auto second = executor->results().latest();
+    ASSERT_EQ(second->epoch, 2);
+    ASSERT_EQ(second->find(result1)->cast<int>(), 6);
+    // Readers holding the old snapshot still see its values
+    ASSERT_EQ(first->find(result1)->cast<int>(), 2);
+    // Unchanged values are shared
+    ASSERT_EQ(first->find(result0), second->find(result0));
+
+    // A reader never waits for, nor sees a partial, run
+    std::atomic<bool> done = false;
+    std::thread reader([&]() {
+        uint64_t last_epoch = 0;
+        while (!done) {
+            auto snapshot = executor->results().latest();
+            ASSERT_GE(snapshot->epoch, last_epoch);
+            last_epoch = snapshot->epoch;
+            auto b = snapshot->find(result1)->cast<int>() - 1;
+            ASSERT_GE(b, 5);
+        }
+    });
+    for (int b = 6; b < 200; ++b) {
+        executor->prepare_tree(tree.get());
+        executor->sync_node_from_external_storage(
+            node1->get_input_socket("b"), b);
+        executor->execute_tree(tree.get());
+    }
+    done = true;
+    reader.join();
+    ASSERT_EQ(executor->results().epoch(), 196);
+}
+
+TEST_F(NodeExecTest, TimeSlicedExecution)
+{
+    auto executor = create_node_tree_executor({});
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+
+    // A spent budget still runs one node per call
+    executor->prepare_tree(tree.get());
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 0));
+    ASSERT_TRUE(executor->has_unfinished_run());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 1);
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 0));
+    ASSERT_TRUE(executor->execute_tree_for(tree.get(), 0));
+    ASSERT_FALSE(executor->has_unfinished_run());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 3);
+
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        node2->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 3);
+
+    // Preparing again restarts, the node already done is not run again
+    executor->reset_counters();
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node0->get_input_socket("a"), 4);
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 0));
+    executor->prepare_tree(tree.get());
+    ASSERT_TRUE(executor->execute_tree_for(tree.get(), 1000));
+    ASSERT_EQ(executor->get_counters().nodes_executed, 3);
+    executor->sync_node_to_external_storage(
+        node2->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 7);
+
+    // Deleting a node the paused run already executed drops the run
+    executor->notify_node_dirty(node0);
+    executor->prepare_tree(tree.get());
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 0));
+    tree->delete_node(node0);
+    executor->prepare_tree(tree.get());
+    ASSERT_TRUE(executor->execute_tree_for(tree.get(), 1000));
+    executor->sync_node_to_external_storage(
+        node2->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 2);  // (0+1)+1
+
+    // Resuming without preparing plans the edited tree
+    executor->notify_node_dirty(node1);
+    executor->prepare_tree(tree.get());
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 0));
+    tree->delete_node(node1);
+    ASSERT_TRUE(executor->execute_tree_for(tree.get(), 1000));
+    executor->sync_node_to_external_storage(
+        node2->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 1);
+}
+
+TEST_F(NodeExecTest, AsyncNodes)
+{
+    std::future<int> loading;
+    NodeTypeInfo load_node("load");
+    load_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("result");
+    });
+    load_node.set_execution_function([&loading](ExeParams params) {
+        params.set_output_async("result", std::move(loading));
+        return true;
+    });
+    tree->get_descriptor()->register_node(load_node);
+
+    auto executor = create_node_tree_executor({});
+    auto source = tree->add_node("add");
+    auto load = tree->add_node("load");
+    auto sink = tree->add_node("add");
+    auto independent = tree->add_node("add");
+    tree->add_link(
+        source->get_output_socket("result"), load->get_input_socket("x"));
+    tree->add_link(
+        load->get_output_socket("result"), sink->get_input_socket("a"));
+
+    // Only the nodes reading the loading value wait for it
+    std::promise<int> promise;
+    loading = promise.get_future();
+    executor->prepare_tree(tree.get());
+    ASSERT_FALSE(executor->execute_tree_for(tree.get(), 1000));
+    ASSERT_TRUE(executor->has_unfinished_run());
+    // The loading node counts once its value is there
+    ASSERT_EQ(executor->get_counters().nodes_executed, 2);
+
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        independent->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 1);
+
+    promise.set_value(41);
+    ASSERT_TRUE(executor->execute_tree_for(tree.get(), 1000));
+    ASSERT_EQ(executor->get_counters().nodes_executed, 4);
+    ASSERT_EQ(executor->get_counters().async_completions, 1);
+    executor->sync_node_to_external_storage(
+        sink->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 42);
+
+    // An untimed run waits for the value
+    loading = std::async(std::launch::async, [] { return 9; });
+    executor->notify_node_dirty(load);
+    executor->execute(tree.get());
+    ASSERT_FALSE(executor->has_unfinished_run());
+    executor->sync_node_to_external_storage(
+        sink->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 10);
+
+    // A failed load is reported like any failed node, whatever it threw
+    std::promise<int> failing;
+    failing.set_exception(std::make_exception_ptr(7));
+    loading = failing.get_future();
+    executor->notify_node_dirty(load);
+    diagnostics().clear();
+    executor->execute(tree.get());
+    ASSERT_EQ(load->execution_failed, "Unknown exception");
+    auto reports = diagnostics().snapshot();
+    ASSERT_TRUE(std::any_of(
+        reports.begin(), reports.end(), [&](const Diagnostic& report) {
+            return report.code == DiagnosticCode::NodeFailed &&
+                   report.tree == tree.get() &&
+                   report.node == load->ID.Get();
+        }));
+}
+
+TEST_F(NodeExecTest, PipelinedFrames)
+{
+    std::atomic<int> running = 0;
+    std::atomic<int> max_running = 0;
+    NodeTypeInfo stage_node("stage");
+    stage_node.set_thread_safe(true);
+    stage_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("result");
+    });
+    stage_node.set_execution_function([&](ExeParams params) {
+        auto now_running = ++running;
+        auto seen = max_running.load();
+        while (seen < now_running &&
+               !max_running.compare_exchange_weak(seen, now_running)) {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        running--;
+        params.set_output("result", params.get_input<int>("x") * 2);
+        return true;
+    });
+    tree->get_descriptor()->register_node(stage_node);
+
+    auto node0 = tree->add_node("stage");
+    auto node1 = tree->add_node("stage");
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("x"));
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+
+    auto result = node2->get_output_socket("result");
+    PipelinedTreeExecutor executor(tree.get(), { result }, 4);
+    ASSERT_EQ(executor.stage_count(), 3);
+
+    // Submitting blocks once 4 frames are in flight
+    std::thread producer([&]() {
+        for (int i = 0; i < 8; ++i) {
+            executor.submit({ {}, { { node0->get_input_socket("x"), i } } });
+        }
+    });
+    for (int i = 0; i < 8; ++i) {
+        std::shared_ptr<const ResultSnapshot> frame;
+        while (!(frame = executor.next_result())) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(frame->epoch, i + 1);
+        ASSERT_EQ(frame->find(result)->cast<int>(), i * 4 + 1);
+    }
+    producer.join();
+    ASSERT_FALSE(executor.next_result());
+
+    // Stages of different frames overlapped
+    ASSERT_GT(max_running, 1);
+}
+
+TEST_F(NodeExecTest, ChunkStreams)
+{
+    register_chunk_stream<int>();
+
+    // Far more chunks than a stream buffers, so producers and consumers must
+    // run at the same time
+    std::atomic<int> produced = 0;
+    NodeTypeInfo generate_node("generate");
+    generate_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("count").default_val(1000);
+        b.add_output<ChunkStream<int>>("chunks");
+    });
+    generate_node.set_execution_function([&produced](ExeParams params) {
+        auto count = params.get_input<int>("count");
+        auto stream = params.get_output_stream<int>("chunks");
+        for (int i = 0; i < count && stream.push(i); ++i) {
+            produced++;
+        }
+        stream.close();
+        return true;
+    });
+    tree->get_descriptor()->register_node(generate_node);
+
+    NodeTypeInfo scale_node("scale");
+    scale_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<ChunkStream<int>>("chunks");
+        b.add_output<ChunkStream<int>>("scaled");
+    });
+    scale_node.set_execution_function([](ExeParams params) {
+        auto input = params.get_input<ChunkStream<int>>("chunks");
+        auto output = params.get_output_stream<int>("scaled");
+        while (auto chunk = input.pop()) {
+            if (!output.push(*chunk * 2)) {
+                input.cancel();
+                break;
+            }
+        }
+        output.close();
+        return true;
+    });
+    tree->get_descriptor()->register_node(scale_node);
+
+    NodeTypeInfo sum_node("sum");
+    sum_node.ALWAYS_REQUIRED = true;
+    sum_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<ChunkStream<int>>("chunks");
+        b.add_input<int>("offset");
+        b.add_input<int>("limit").default_val(1 << 30);
+        b.add_output<int>("result");
+    });
+    sum_node.set_execution_function([](ExeParams params) {
+        auto stream = params.get_input<ChunkStream<int>>("chunks");
+        int sum = params.get_input<int>("offset");
+        auto limit = params.get_input<int>("limit");
+        for (int i = 0; i < limit; ++i) {
+            auto chunk = stream.pop();
+            if (!chunk)
+                break;
+            sum += *chunk;
+        }
+        params.set_output("result", sum);
+        return true;
+    });
+    tree->get_descriptor()->register_node(sum_node);
+
+    auto executor = create_node_tree_executor({});
+    auto generate = tree->add_node("generate");
+    auto scale = tree->add_node("scale");
+    auto sum = tree->add_node("sum");
+    tree->add_link(
+        generate->get_output_socket("chunks"),
+        scale->get_input_socket("chunks"));
+    tree->add_link(
+        scale->get_output_socket("scaled"), sum->get_input_socket("chunks"));
+
+    executor->execute(tree.get());
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        sum->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 999000);
+    ASSERT_EQ(produced, 1000);
+
+    // A stream is consumed once, the consumer running again reruns the chain
+    sum->get_input_socket("offset")->set_default_value(1);
+    executor->execute(tree.get());
+    executor->sync_node_to_external_storage(
+        sum->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 999001);
+    ASSERT_EQ(produced, 2000);
+
+    // The consumer stops early, the producers blocked on the undrained
+    // streams are released at the end of the run
+    sum->get_input_socket("limit")->set_default_value(2);
+    executor->execute(tree.get());
+    executor->sync_node_to_external_storage(
+        sum->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 3);
+    ASSERT_LT(produced, 2100);
+
+    // Other outputs would be read while the producer thread writes them
+    NodeTypeInfo mixed_node("mixed");
+    mixed_node.ALWAYS_REQUIRED = true;
+    mixed_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<ChunkStream<int>>("chunks");
+        b.add_output<int>("count");
+    });
+    mixed_node.set_execution_function([](ExeParams params) {
+        params.get_output_stream<int>("chunks").close();
+        params.set_output("count", 0);
+        return true;
+    });
+    tree->get_descriptor()->register_node(mixed_node);
+
+    auto mixed = tree->add_node("mixed");
+    executor->execute(tree.get());
+    ASSERT_FALSE(mixed->execution_failed.empty());
+}
+
+TEST_F(NodeExecTest, ForEachZone)
+{
+    NodeTypeInfo square_node("square");
+    square_node.set_thread_safe(true);
+    square_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_input<int>("offset");
+        b.add_output<int>("result");
+    });
+    square_node.set_execution_function([](ExeParams params) {
+        auto x = params.get_input<int>("x");
+        params.set_output("result", x * x + params.get_input<int>("offset"));
+        return true;
+    });
+    tree->get_descriptor()->register_node(square_node);
+
+    // Paired and synchronized the way the editor creates a zone
+    auto begin = tree->add_node(FOREACH_BEGIN_IDENTIFIER);
+    auto end = tree->add_node(FOREACH_END_IDENTIFIER);
+    begin->paired_node = end;
+    end->paired_node = begin;
+    auto sync = tree->get_descriptor()->require_syncronization(
+        FOREACH_BEGIN_IDENTIFIER);
+    ASSERT_EQ(sync.size(), 3);
+    auto captured_in = begin->find_socket_group("Captured", PinKind::Input);
+    captured_in->add_sync_group(
+        begin->find_socket_group("Captured", PinKind::Output));
+    captured_in->add_sync_group(
+        end->find_socket_group("Captured", PinKind::Output));
+    begin->find_socket_group("Captured", PinKind::Output)
+        ->add_sync_group(end->find_socket_group("Captured", PinKind::Output));
+
+    auto square = tree->add_node("square");
+    auto offset = tree->add_node("add");
+    tree->add_link(
+        begin->get_output_socket("Element"), square->get_input_socket("x"));
+    // The offset reaches the body through the captured sockets
+    auto captured = begin->group_add_socket(
+        "Captured",
+        type_name<int>().c_str(),
+        "offset",
+        "offset",
+        PinKind::Input);
+    tree->add_link(offset->get_output_socket("result"), captured);
+    auto captured_ids =
+        begin->find_socket_group_ids("Captured", PinKind::Output);
+    ASSERT_EQ(captured_ids.size(), 1);
+    tree->add_link(
+        begin->get_outputs()[captured_ids[0]],
+        square->get_input_socket("offset"));
+    tree->add_link(
+        square->get_output_socket("result"), end->get_input_socket("Result"));
+
+    std::vector<entt::meta_any> elements;
+    for (int i = 0; i < 100; ++i) {
+        elements.emplace_back(i);
+    }
+
+    auto executor = create_node_tree_executor({});
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().foreach_iterations, 100);
+
+    entt::meta_any results;
+    executor->sync_node_to_external_storage(
+        end->get_output_socket("Results"), results);
+    auto& values = results.cast<const std::vector<entt::meta_any>&>();
+    ASSERT_EQ(values.size(), 100);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(values[i].cast<int>(), i * i + 1);
+    }
+    auto passed_on = end->find_socket_group_ids("Captured", PinKind::Output);
+    ASSERT_EQ(passed_on.size(), 1);
+    executor->sync_node_to_external_storage(
+        end->get_outputs()[passed_on[0]], results);
+    ASSERT_EQ(results.cast<int>(), 1);
+
+    // Nothing changed
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().foreach_iterations, 100);
+
+    // A value read by the body changed
+    offset->get_input_socket("b")->set_default_value(5);
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().foreach_iterations, 200);
+    executor->sync_node_to_external_storage(
+        end->get_output_socket("Results"), results);
+    ASSERT_EQ(
+        results.cast<const std::vector<entt::meta_any>&>()[3].cast<int>(), 14);
+}
+
+TEST_F(NodeExecTest, ForEachZoneRefusesPairedBody)
+{
+    auto begin = tree->add_node(FOREACH_BEGIN_IDENTIFIER);
+    auto end = tree->add_node(FOREACH_END_IDENTIFIER);
+    begin->paired_node = end;
+    end->paired_node = begin;
+    // Stand in for a simulation zone inside the body
+    auto sim_in = tree->add_node("add");
+    auto sim_out = tree->add_node("add");
+    sim_in->paired_node = sim_out;
+    sim_out->paired_node = sim_in;
+    tree->add_link(
+        begin->get_output_socket("Index"), sim_in->get_input_socket("a"));
+    tree->add_link(
+        sim_in->get_output_socket("result"), sim_out->get_input_socket("a"));
+    tree->add_link(
+        sim_out->get_output_socket("result"),
+        end->get_input_socket("Result"));
+
+    std::vector<entt::meta_any> elements(4);
+    auto executor = create_node_tree_executor({});
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().foreach_iterations, 0);
+    ASSERT_FALSE(end->execution_failed.empty());
+}
+
+TEST_F(NodeExecTest, ForEachZoneRefusesOutsideReaders)
+{
+    auto begin = tree->add_node(FOREACH_BEGIN_IDENTIFIER);
+    auto end = tree->add_node(FOREACH_END_IDENTIFIER);
+    begin->paired_node = end;
+    end->paired_node = begin;
+    auto body = tree->add_node("add");
+    auto outside = tree->add_node("add");
+    tree->add_link(
+        begin->get_output_socket("Index"), body->get_input_socket("a"));
+    tree->add_link(
+        body->get_output_socket("result"), end->get_input_socket("Result"));
+    tree->add_link(
+        body->get_output_socket("result"), outside->get_input_socket("a"));
+
+    std::vector<entt::meta_any> elements(4);
+    auto executor = create_node_tree_executor({});
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->get_counters().foreach_iterations, 0);
+    ASSERT_NE(end->execution_failed.find("outside"), std::string::npos);
+}
+
+TEST_F(NodeExecTest, ForkedVariants)
+{
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+
+    auto executor = create_node_tree_executor({});
+    executor->execute(tree.get());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 3);
+
+    auto result_of = [](NodeTreeExecutor* executor, Node* node) {
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            node->get_output_socket("result"), result);
+        return result.cast<int>();
+    };
+
+    // Only the variant's changes execute in the fork
+    auto variant = executor->fork();
+    variant->prepare_tree(tree.get());
+    variant->sync_node_from_external_storage(node0->get_input_socket("b"), 10);
+    variant->execute_tree(tree.get());
+    ASSERT_EQ(variant->get_counters().nodes_executed, 2);
+    ASSERT_EQ(result_of(variant.get(), node1), 11);
+    ASSERT_EQ(result_of(variant.get(), node2), 1);
+
+    // The parent and the tree are left alone
+    ASSERT_EQ(node0->get_input_socket("b")->default_value_typed<int>(), 1);
+    executor->execute(tree.get());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 3);
+    ASSERT_EQ(result_of(executor.get(), node1), 2);
+
+    auto unrelated = executor->clone_empty();
+    ASSERT_FALSE(executor->commit_fork(*unrelated));
+
+    ASSERT_TRUE(executor->commit_fork(*variant));
+    ASSERT_EQ(node0->get_input_socket("b")->default_value_typed<int>(), 10);
+    executor->execute(tree.get());
+    ASSERT_EQ(executor->get_counters().nodes_executed, 3);
+    ASSERT_EQ(result_of(executor.get(), node1), 11);
+
+    // Zone state lives on the nodes the fork would share
+    node1->paired_node = node2;
+    node2->paired_node = node1;
+    executor->prepare_tree(tree.get());
+    ASSERT_EQ(executor->fork(), nullptr);
+}
+
+TEST_F(NodeExecTest, ExecutionQualities)
+{
+    int blur_runs = 0;
+    NodeTypeInfo blur_node("blur");
+    blur_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("result");
+    });
+    blur_node.set_execution_function([&blur_runs](ExeParams params) {
+        blur_runs++;
+        auto scale =
+            params.get_quality() == ExecutionQuality::Preview ? 10 : 100;
+        params.set_output("result", params.get_input<int>("x") * scale);
+        return true;
+    });
+    tree->get_descriptor()->register_node(blur_node);
+
+    auto source = tree->add_node("add");
+    auto blur = tree->add_node("blur");
+    auto sink = tree->add_node("add");
+    tree->add_link(
+        source->get_output_socket("result"), blur->get_input_socket("x"));
+    tree->add_link(
+        blur->get_output_socket("result"), sink->get_input_socket("a"));
+
+    auto executor = create_node_tree_executor({});
+    auto result_of_sink = [&]() {
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            sink->get_output_socket("result"), result);
+        return result.cast<int>();
+    };
+
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 101);
+
+    // Only the nodes reading the quality and their downstream execute
+    executor->set_quality(ExecutionQuality::Preview);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 11);
+    ASSERT_EQ(blur_runs, 2);
+    ASSERT_EQ(executor->get_counters().nodes_executed, 5);
+
+    // The preview left the final results alone
+    executor->set_quality(ExecutionQuality::Final);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 101);
+    ASSERT_EQ(blur_runs, 2);
+    ASSERT_EQ(executor->get_counters().quality_cache_hits, 2);
+
+    // Anything else changing drops the results of the other qualities
+    source->get_input_socket("b")->set_default_value(2);
+    executor->set_quality(ExecutionQuality::Preview);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 21);
+    executor->set_quality(ExecutionQuality::Final);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 201);
+    ASSERT_EQ(blur_runs, 4);
+
+    // A group passes the quality on to the tree inside it
+    tree->group_up({ blur });
+    executor = create_node_tree_executor({});
+    executor->set_quality(ExecutionQuality::Preview);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 21);
+    executor->set_quality(ExecutionQuality::Final);
+    executor->execute(tree.get());
+    ASSERT_EQ(result_of_sink(), 201);
+}
+
+TEST_F(NodeExecTest, QualityCacheSkipsStreams)
+{
+    register_chunk_stream<int>();
+
+    NodeTypeInfo generate_node("generate");
+    generate_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<ChunkStream<int>>("chunks");
+    });
+    generate_node.set_execution_function([](ExeParams params) {
+        auto stream = params.get_output_stream<int>("chunks");
+        for (int i = 0; i < 10 && stream.push(i); ++i) {
+        }
+        stream.close();
+        return true;
+    });
+    tree->get_descriptor()->register_node(generate_node);
+
+    int sum_runs = 0;
+    NodeTypeInfo sum_node("sum");
+    sum_node.ALWAYS_REQUIRED = true;
+    sum_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<ChunkStream<int>>("chunks");
+        b.add_output<int>("result");
+    });
+    sum_node.set_execution_function([&sum_runs](ExeParams params) {
+        sum_runs++;
+        auto stream = params.get_input<ChunkStream<int>>("chunks");
+        int sum = params.get_quality() == ExecutionQuality::Preview ? 1 : 0;
+        while (auto chunk = stream.pop()) {
+            sum += *chunk;
+        }
+        params.set_output("result", sum);
+        return true;
+    });
+    tree->get_descriptor()->register_node(sum_node);
+
+    auto generate = tree->add_node("generate");
+    auto sum = tree->add_node("sum");
+    tree->add_link(
+        generate->get_output_socket("chunks"), sum->get_input_socket("chunks"));
+
+    // Each run streams again, so the consumer can never be restored
+    auto executor = create_node_tree_executor({});
+    executor->execute(tree.get());
+    executor->set_quality(ExecutionQuality::Preview);
+    executor->execute(tree.get());
+    executor->set_quality(ExecutionQuality::Final);
+    executor->execute(tree.get());
+    ASSERT_EQ(sum_runs, 3);
+    ASSERT_EQ(executor->get_counters().quality_cache_hits, 0);
+
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        sum->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 45);
+}
+
+TEST_F(NodeExecTest, MemoryReport)
+{
+    register_container_size_estimator<std::vector<int>>();
+
+    NodeTypeInfo fill_node("fill");
+    fill_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("count").default_val(1000);
+        b.add_output<std::vector<int>>("values");
+    });
+    fill_node.set_execution_function([](ExeParams params) {
+        auto count = params.get_input<int>("count");
+        params.set_output("values", std::vector<int>(count, 1));
+        return true;
+    });
+    fill_node.ALWAYS_REQUIRED = true;
+    tree->get_descriptor()->register_node(fill_node);
+
+    auto executor = create_node_tree_executor({});
+    auto fill = tree->add_node("fill");
+    auto add = tree->add_node("add");
+    executor->execute(tree.get());
+
+    auto report = executor->memory_report();
+    // The vector is held by the current state and the persistent cache.
+    ASSERT_GE(report.per_node[fill].bytes, 2 * 1000 * sizeof(int));
+    ASSERT_LT(report.per_node[add].bytes, 100);
+    ASSERT_EQ(
+        report.per_category["current"].bytes,
+        report.per_category["persistent"].bytes);
+    ASSERT_EQ(report.per_type[type_name<std::vector<int>>()].values, 2);
+
+    auto json = report.to_json();
+    ASSERT_EQ(json["nodes"][0]["id"], fill->ID.Get());
+    ASSERT_EQ(json["total"]["bytes"], report.total.bytes);
+}
+
+TEST_F(NodeExecTest, MemoryReportOfGroups)
+{
+    register_container_size_estimator<std::vector<int>>();
+
+    NodeTypeInfo fill_node("fill");
+    fill_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<std::vector<int>>("values");
+    });
+    fill_node.set_execution_function([](ExeParams params) {
+        params.set_output("values", std::vector<int>(1000, 1));
+        return true;
+    });
+    tree->get_descriptor()->register_node(fill_node);
+
+    NodeTypeInfo count_node("count");
+    count_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<std::vector<int>>("values");
+        b.add_output<int>("count");
+    });
+    count_node.set_execution_function([](ExeParams params) {
+        auto values = params.get_input<std::vector<int>>("values");
+        params.set_output("count", static_cast<int>(values.size()));
+        return true;
+    });
+    tree->get_descriptor()->register_node(count_node);
+
+    auto executor = create_node_tree_executor({});
+    auto fill = tree->add_node("fill");
+    auto count = tree->add_node("count");
+    auto add = tree->add_node("add");
+    tree->add_link(
+        fill->get_output_socket("values"), count->get_input_socket("values"));
+    tree->add_link(
+        count->get_output_socket("count"), add->get_input_socket("a"));
+    auto group = tree->group_up(std::vector<Node*>{ fill });
+    executor->execute(tree.get());
+
+    // The vectors kept inside the subtree are charged to the group.
+    auto report = executor->memory_report();
+    ASSERT_GE(report.per_node[group].bytes, 2 * 1000 * sizeof(int));
+    ASSERT_EQ(report.per_category["node_storage"].values, 0);
+}
+
+TEST_F(NodeExecTest, ExplainExecution)
+{
+    auto executor_ptr = create_node_tree_executor({});
+    auto executor = dynamic_cast<EagerNodeTreeExecutor*>(executor_ptr.get());
+
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+
+    // First run, nothing was cached.
+    executor->execute(tree.get());
+    ASSERT_TRUE(executor->dirty_cause_chain(node0).empty());
+    ASSERT_NE(
+        executor->explain_execution(node0).find("no cached result"),
+        std::string::npos);
+
+    // An external edit at the head reaches node2 through node1.
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node0->get_input_socket("b"), 7);
+    executor->execute_tree(tree.get());
+
+    auto chain = executor->dirty_cause_chain(node2);
+    ASSERT_EQ(chain.size(), 3);
+    ASSERT_EQ(chain[0].cause, DirtyCause::UpstreamDirty);
+    ASSERT_EQ(chain[0].source, node1->ID.Get());
+    ASSERT_EQ(chain[1].node, node1->ID.Get());
+    ASSERT_EQ(chain[2].cause, DirtyCause::ExternalInput);
+    ASSERT_EQ(chain[2].socket, node0->get_input_socket("b")->ID.Get());
+
+    auto text = executor->explain_execution(node2);
+    ASSERT_NE(text.find("external input changed"), std::string::npos);
+
+    // Nothing changed, nothing to explain.
+    executor->execute(tree.get());
+    ASSERT_NE(
+        executor->explain_execution(node2).find("did not execute"),
+        std::string::npos);
+
+    // With a single slot only the latest event survives.
+    executor->set_dirty_trace_capacity(1);
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node0->get_input_socket("b"), 8);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(executor->dirty_cause_chain(node2).size(), 1);
+}
+
+TEST_F(NodeExecTest, Diagnostics)
+{
+    DiagnosticsChannel channel(4);
+    auto node = tree->add_node("add");
+    auto node_id = node->ID.Get();
+    auto socket_id = node->get_input_socket("a")->ID.Get();
+
+    // The same failure of the same node every run takes a single entry.
+    for (int i = 0; i < 10; ++i) {
+        channel.report(
+            DiagnosticCode::MissingInput, tree.get(), node_id, socket_id, 2);
+    }
+    auto entries = channel.snapshot();
+    ASSERT_EQ(entries.size(), 1);
+    ASSERT_EQ(entries[0].repeat, 10);
+
+    auto text = channel.format(entries[0], tree.get());
+    ASSERT_NE(text.find("'add'"), std::string::npos);
+    ASSERT_NE(text.find("'a' and 1 more"), std::string::npos);
+    ASSERT_NE(text.find("(x10)"), std::string::npos);
+
+    // Without the tree the IDs are printed instead.
+    text = channel.format(entries[0]);
+    ASSERT_NE(text.find(std::to_string(node_id)), std::string::npos);
+
+    auto int_id = entt::type_hash<int>().value();
+    auto float_id = entt::type_hash<float>().value();
+    channel.report(
+        DiagnosticCode::InputTypeMismatch,
+        tree.get(),
+        node_id,
+        socket_id,
+        float_id,
+        int_id);
+    text = channel.format(channel.snapshot().back(), tree.get());
+    ASSERT_NE(text.find("from type float to type int"), std::string::npos);
+
+    // Older entries are overwritten once the ring is full.
+    for (uint64_t id = 1000; id < 1004; ++id) {
+        channel.report(DiagnosticCode::NodeDeleted, tree.get(), id);
+    }
+    entries = channel.snapshot();
+    ASSERT_EQ(entries.size(), 4);
+    ASSERT_EQ(entries.front().node, 1000);
+    ASSERT_EQ(channel.dropped(), 2);
+
+    channel.clear();
+    ASSERT_TRUE(channel.snapshot().empty());
+
+    // A tree only flushes its own entries; the same node ID in another
+    // tree is a different entry.
+    auto other = create_node_tree(tree->get_descriptor());
+    channel.report(DiagnosticCode::MissingInput, tree.get(), node_id);
+    channel.report(DiagnosticCode::MissingInput, other.get(), node_id);
+    ASSERT_EQ(channel.snapshot().size(), 2);
+    channel.flush_to_log(other.get());
+    entries = channel.snapshot();
+    ASSERT_FALSE(entries[0].logged);
+    ASSERT_TRUE(entries[1].logged);
+    channel.flush_to_log(tree.get());
+    ASSERT_TRUE(channel.snapshot()[0].logged);
+    ASSERT_EQ(channel.dropped(), 0);
+
+    // Deletions are debug diagnostics, compiled out by default.
+    ASSERT_FALSE(diagnostic_enabled<DiagnosticCode::NodeDeleted>);
+    ASSERT_TRUE(diagnostic_enabled<DiagnosticCode::MissingInput>);
+}
+
 TEST_F(NodeExecTest, CacheWithUpstreamChange)
 {
     NodeTreeExecutorDesc desc;
@@ -616,3 +1605,602 @@ TEST_F(NodeExecTest, ReconnectUsesNewUpstreamData)
 
     std::cout << "\n=== Test Complete ===" << std::endl;
 }
+
+TEST_F(NodeExecTest, FrameCache)
+{
+    static int frame_node_runs = 0;
+    frame_node_runs = 0;
+
+    NodeTypeInfo frame_node("frame");
+    frame_node.ALWAYS_DIRTY = true;
+    frame_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<int>("frame");
+    });
+    frame_node.set_execution_function([](ExeParams params) {
+        frame_node_runs++;
+        params.set_output("frame", params.get_global_payload<int>());
+        return true;
+    });
+    tree->get_descriptor()->register_node(frame_node);
+
+    auto executor = create_node_tree_executor({});
+    auto time = tree->add_node("frame");
+    auto add = tree->add_node("add");
+    tree->add_link(
+        time->get_output_socket("frame"), add->get_input_socket("a"));
+
+    executor->enable_frame_cache(1024);
+
+    auto run_frame = [&](int frame) {
+        executor->set_global_payload(entt::meta_any{ frame });
+        executor->set_frame(frame);
+        executor->execute(tree.get());
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            add->get_output_socket("result"), result);
+        return result.cast<int>();
+    };
+
+    for (int frame = 0; frame < 3; ++frame) {
+        ASSERT_EQ(run_frame(frame), frame + 1);
+    }
+    ASSERT_EQ(frame_node_runs, 3);
+
+    // Scrubbing back is served from the cache.
+    ASSERT_EQ(run_frame(1), 2);
+    ASSERT_EQ(run_frame(0), 1);
+    ASSERT_EQ(frame_node_runs, 3);
+
+    // An edit outside the time cone drops the cached frames.
+    executor->sync_node_from_external_storage(add->get_input_socket("b"), 5);
+    ASSERT_EQ(run_frame(1), 6);
+    ASSERT_EQ(frame_node_runs, 4);
+
+    // So does a payload edit without a frame change
+    executor->set_global_payload(entt::meta_any{ 10 });
+    executor->execute(tree.get());
+    entt::meta_any edited;
+    executor->sync_node_to_external_storage(
+        add->get_output_socket("result"), edited);
+    ASSERT_EQ(edited.cast<int>(), 15);
+    ASSERT_EQ(frame_node_runs, 5);
+
+    // Frames over budget are not stored.
+    executor->enable_frame_cache(1);
+    executor->mark_tree_structure_changed();
+    run_frame(2);
+    run_frame(2);
+    ASSERT_EQ(frame_node_runs, 7);
+}
+
+struct FrameAccumulator {
+    int total = 0;
+    static constexpr bool has_storage = false;
+};
+
+TEST_F(NodeExecTest, ForEachZoneSharedNodeState)
+{
+    register_cpp_type<FrameAccumulator>();
+
+    // THREAD_SAFE, but its storage is shared by every element
+    NodeTypeInfo count_node("count");
+    count_node.set_thread_safe(true);
+    count_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("total");
+    });
+    count_node.set_execution_function([](ExeParams params) {
+        auto x = params.get_input<int>("x");
+        if (x < 0) {
+            params.set_error("negative element");
+            return false;
+        }
+        auto& storage = params.get_storage<FrameAccumulator&>();
+        storage.total += 1;
+        params.set_output("total", storage.total);
+        return true;
+    });
+    tree->get_descriptor()->register_node(count_node);
+
+    auto begin = tree->add_node(FOREACH_BEGIN_IDENTIFIER);
+    auto end = tree->add_node(FOREACH_END_IDENTIFIER);
+    begin->paired_node = end;
+    end->paired_node = begin;
+    auto count = tree->add_node("count");
+    tree->add_link(
+        begin->get_output_socket("Element"), count->get_input_socket("x"));
+    tree->add_link(
+        count->get_output_socket("total"), end->get_input_socket("Result"));
+
+    std::vector<entt::meta_any> elements;
+    for (int i = 0; i < 1000; ++i) {
+        elements.emplace_back(i);
+    }
+    auto executor = create_node_tree_executor({});
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(count->storage.cast<FrameAccumulator&>().total, 1000);
+    entt::meta_any results;
+    executor->sync_node_to_external_storage(
+        end->get_output_socket("Results"), results);
+    ASSERT_EQ(
+        results.cast<const std::vector<entt::meta_any>&>()[999].cast<int>(),
+        1000);
+
+    // Errors stay with the element, not on the shared node
+    elements[3] = entt::meta_any{ -1 };
+    executor->prepare_tree(tree.get(), end);
+    executor->sync_node_from_external_storage(
+        begin->get_input_socket("Elements"), elements);
+    executor->execute_tree(tree.get());
+    ASSERT_NE(
+        end->execution_failed.find("Iteration 3: "), std::string::npos);
+    ASSERT_NE(
+        end->execution_failed.find("negative element"), std::string::npos);
+    ASSERT_TRUE(count->error_message.empty());
+}
+
+TEST_F(NodeExecTest, FrameCacheSkipsStatefulNodes)
+{
+    register_cpp_type<FrameAccumulator>();
+
+    NodeTypeInfo frame_node("frame");
+    frame_node.ALWAYS_DIRTY = true;
+    frame_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<int>("frame");
+    });
+    frame_node.set_execution_function([](ExeParams params) {
+        params.set_output("frame", params.get_global_payload<int>());
+        return true;
+    });
+    tree->get_descriptor()->register_node(frame_node);
+
+    NodeTypeInfo accumulate_node("accumulate");
+    accumulate_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("value");
+        b.add_output<int>("total");
+    });
+    accumulate_node.set_execution_function([](ExeParams params) {
+        auto& storage = params.get_storage<FrameAccumulator&>();
+        storage.total += params.get_input<int>("value");
+        params.set_output("total", storage.total);
+        return true;
+    });
+    tree->get_descriptor()->register_node(accumulate_node);
+
+    auto executor = create_node_tree_executor({});
+    auto time = tree->add_node("frame");
+    auto accumulate = tree->add_node("accumulate");
+    auto add = tree->add_node("add");
+    tree->add_link(
+        time->get_output_socket("frame"),
+        accumulate->get_input_socket("value"));
+    tree->add_link(
+        accumulate->get_output_socket("total"), add->get_input_socket("a"));
+
+    executor->enable_frame_cache(1024);
+
+    auto run_frame = [&](int frame) {
+        executor->set_global_payload(entt::meta_any{ frame });
+        executor->set_frame(frame);
+        executor->execute(tree.get());
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            add->get_output_socket("result"), result);
+        return result.cast<int>();
+    };
+
+    ASSERT_EQ(run_frame(1), 2);
+    ASSERT_EQ(run_frame(2), 4);
+    // Revisiting a frame still advances the storage, and what reads it.
+    ASSERT_EQ(run_frame(1), 5);
+    ASSERT_EQ(accumulate->storage.cast<FrameAccumulator&>().total, 4);
+}
+
+TEST_F(NodeExecTest, GlobalPayloadDependencies)
+{
+    static int reader_runs = 0;
+    reader_runs = 0;
+
+    NodeTypeInfo reader_node("payload_reader");
+    reader_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<int>("value");
+    });
+    reader_node.set_execution_function([](ExeParams params) {
+        reader_runs++;
+        params.set_output("value", params.get_global_payload<int>("scale"));
+        return true;
+    });
+    tree->get_descriptor()->register_node(reader_node);
+
+    NodeTypeInfo declared_node("payload_declared");
+    declared_node.ALWAYS_REQUIRED = true;
+    declared_node.set_payload_dependencies({ "time" });
+    declared_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_output<int>("value");
+    });
+    declared_node.set_execution_function([](ExeParams params) {
+        params.set_output("value", 0);
+        return true;
+    });
+    tree->get_descriptor()->register_node(declared_node);
+
+    auto executor_ptr = create_node_tree_executor({});
+    auto executor = dynamic_cast<EagerNodeTreeExecutor*>(executor_ptr.get());
+
+    auto reader = tree->add_node("payload_reader");
+    auto declared = tree->add_node("payload_declared");
+    auto downstream = tree->add_node("add");
+    auto unrelated = tree->add_node("add");
+    tree->add_link(
+        reader->get_output_socket("value"),
+        downstream->get_input_socket("a"));
+
+    executor->set_global_payload(entt::meta_any{ 2 });
+    executor->execute(tree.get());
+    ASSERT_EQ(reader_runs, 1);
+
+    // A field nobody reads dirties nothing.
+    executor->set_global_payload(entt::meta_any{ 3 }, { "exposure" });
+    ASSERT_FALSE(executor->is_node_dirty(reader));
+    ASSERT_FALSE(executor->is_node_dirty(declared));
+
+    // The tracked field reaches the reader's downstream cone only.
+    executor->set_global_payload(entt::meta_any{ 4 }, { "scale" });
+    ASSERT_TRUE(executor->is_node_dirty(reader));
+    ASSERT_TRUE(executor->is_node_dirty(downstream));
+    ASSERT_FALSE(executor->is_node_dirty(declared));
+    ASSERT_FALSE(executor->is_node_dirty(unrelated));
+    executor->execute(tree.get());
+    ASSERT_EQ(reader_runs, 2);
+
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        downstream->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 5);
+
+    // Declared dependencies count without any read.
+    executor->notify_global_payload_changed({ "time" });
+    ASSERT_TRUE(executor->is_node_dirty(declared));
+    ASSERT_FALSE(executor->is_node_dirty(reader));
+
+    // An unnamed change concerns every payload reader, and an equal payload
+    // nothing at all.
+    executor->execute(tree.get());
+    executor->set_global_payload(entt::meta_any{ 4 });
+    ASSERT_FALSE(executor->is_node_dirty(reader));
+    executor->set_global_payload(entt::meta_any{ 5 });
+    ASSERT_TRUE(executor->is_node_dirty(reader));
+    ASSERT_TRUE(executor->is_node_dirty(declared));
+    ASSERT_FALSE(executor->is_node_dirty(unrelated));
+}
+
+TEST_F(NodeExecTest, LazyInputs)
+{
+    static std::map<int, int> runs;
+    runs.clear();
+    static int switch_runs = 0;
+    switch_runs = 0;
+
+    NodeTypeInfo source_node("source");
+    source_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("value");
+    });
+    source_node.set_execution_function([](ExeParams params) {
+        auto x = params.get_input<int>("x");
+        runs[x]++;
+        params.set_output("value", x);
+        return true;
+    });
+    tree->get_descriptor()->register_node(source_node);
+
+    NodeTypeInfo switch_node("switch");
+    switch_node.ALWAYS_REQUIRED = true;
+    switch_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("cond");
+        b.add_input<int>("a").lazy();
+        b.add_input<int>("b").lazy();
+        b.add_output<int>("result");
+    });
+    switch_node.set_execution_function([](ExeParams params) {
+        switch_runs++;
+        auto taken = params.get_input<int>("cond") ? "b" : "a";
+        params.set_output("result", params.get_input<int>(taken));
+        return true;
+    });
+    tree->get_descriptor()->register_node(switch_node);
+
+    auto executor = create_node_tree_executor({});
+    auto branch_a = tree->add_node("source");
+    auto branch_b = tree->add_node("source");
+    auto select = tree->add_node("switch");
+    tree->add_link(
+        branch_a->get_output_socket("value"), select->get_input_socket("a"));
+    tree->add_link(
+        branch_b->get_output_socket("value"), select->get_input_socket("b"));
+
+    // Synced values stick to the socket, so the sources are set only once.
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(
+        branch_a->get_input_socket("x"), 10);
+    executor->sync_node_from_external_storage(
+        branch_b->get_input_socket("x"), 20);
+
+    auto run = [&](int cond) {
+        executor->prepare_tree(tree.get());
+        executor->sync_node_from_external_storage(
+            select->get_input_socket("cond"), cond);
+        executor->execute_tree(tree.get());
+
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            select->get_output_socket("result"), result);
+        return result.cast<int>();
+    };
+
+    // The branch not taken is never computed.
+    ASSERT_EQ(run(0), 10);
+    ASSERT_EQ(runs[10], 1);
+    ASSERT_EQ(runs[20], 0);
+
+    // Nothing changed: the branch never computed does not keep the switch
+    // dirty.
+    auto switch_runs_before = switch_runs;
+    executor->execute(tree.get());
+    ASSERT_EQ(switch_runs, switch_runs_before);
+
+    ASSERT_EQ(run(1), 20);
+    ASSERT_EQ(runs[10], 1);
+    ASSERT_EQ(runs[20], 1);
+
+    // Switching back reuses the cached branch.
+    ASSERT_EQ(run(0), 10);
+    ASSERT_EQ(runs[10], 1);
+
+    switch_runs_before = switch_runs;
+
+    // An edit upstream of the taken branch still reaches it.
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(
+        branch_a->get_input_socket("x"), 30);
+    ASSERT_EQ(run(0), 30);
+    ASSERT_EQ(switch_runs, switch_runs_before + 1);
+}
+
+TEST_F(NodeExecTest, LazyInputGroup)
+{
+    NodeTypeInfo merge_node("lazy_merge");
+    merge_node.ALWAYS_REQUIRED = true;
+    merge_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input_group<int>("inputs").set_runtime_dynamic(true);
+        b.add_output<int>("result");
+    });
+    merge_node.set_execution_function([](ExeParams params) {
+        int sum = 0;
+        for (auto value : params.get_input_group<int>("inputs")) {
+            sum += value;
+        }
+        params.set_output("result", sum);
+        return true;
+    });
+    tree->get_descriptor()->register_node(merge_node);
+
+    NodeTypeInfo one_node("one");
+    one_node.set_declare_function(
+        [](NodeDeclarationBuilder& b) { b.add_output<int>("value"); });
+    one_node.set_execution_function([](ExeParams params) {
+        params.set_output("value", 1);
+        return true;
+    });
+    tree->get_descriptor()->register_node(one_node);
+
+    auto executor = create_node_tree_executor({});
+    auto merge = tree->add_node("lazy_merge");
+    for (int i = 0; i < 2; ++i) {
+        auto one = tree->add_node("one");
+        auto identifier = "input_" + std::to_string(i);
+        auto socket = merge->group_add_socket(
+            "inputs",
+            type_name<int>().c_str(),
+            identifier.c_str(),
+            identifier.c_str(),
+            PinKind::Input);
+        socket->lazy = true;
+        tree->add_link(one->get_output_socket("value"), socket);
+    }
+
+    // Reading the group pulls every lazy member in.
+    executor->execute(tree.get());
+    entt::meta_any result;
+    executor->sync_node_to_external_storage(
+        merge->get_output_socket("result"), result);
+    ASSERT_EQ(result.cast<int>(), 2);
+}
+
+TEST_F(NodeExecTest, PureNodeReuse)
+{
+    static int square_runs = 0;
+    square_runs = 0;
+
+    NodeTypeInfo square_node("square");
+    square_node.set_pure(true);
+    square_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("x");
+        b.add_output<int>("result");
+    });
+    square_node.set_execution_function([](ExeParams params) {
+        square_runs++;
+        auto x = params.get_input<int>("x");
+        params.set_output("result", x * x);
+        return true;
+    });
+    tree->get_descriptor()->register_node(square_node);
+
+    auto executor = create_node_tree_executor({});
+    auto source = tree->add_node("add");
+    auto square = tree->add_node("square");
+    auto sink = tree->add_node("add");
+    tree->add_link(
+        source->get_output_socket("result"), square->get_input_socket("x"));
+    tree->add_link(
+        square->get_output_socket("result"), sink->get_input_socket("a"));
+
+    auto result = [&]() {
+        entt::meta_any value;
+        executor->sync_node_to_external_storage(
+            sink->get_output_socket("result"), value);
+        return value.cast<int>();
+    };
+
+    executor->execute(tree.get());
+    ASSERT_EQ(square_runs, 1);
+    ASSERT_EQ(result(), 2);
+
+    // The whole cone is dirty, but the source produces the same value again.
+    executor->notify_socket_dirty(source->get_input_socket("b"));
+    executor->reset_counters();
+    executor->execute(tree.get());
+    ASSERT_EQ(square_runs, 1);
+    ASSERT_EQ(executor->get_counters().pure_reuses, 1);
+    ASSERT_EQ(result(), 2);
+
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(source->get_input_socket("b"), 3);
+    executor->execute_tree(tree.get());
+    ASSERT_EQ(square_runs, 2);
+    ASSERT_EQ(result(), 10);
+}
+
+TEST_F(NodeExecTest, VersionedDefaults)
+{
+    auto executor = create_node_tree_executor({});
+    auto node = tree->add_node("add");
+    auto b = node->get_input_socket("b");
+
+    auto result = [&]() {
+        entt::meta_any value;
+        executor->sync_node_to_external_storage(
+            node->get_output_socket("result"), value);
+        return value.cast<int>();
+    };
+
+    executor->execute(tree.get());
+    ASSERT_EQ(result(), 1);
+    ASSERT_EQ(executor->get_counters().defaults_copied, 2);
+
+    // Written without telling the executor
+    b->set_default_value(5);
+    executor->reset_counters();
+    executor->execute(tree.get());
+    ASSERT_EQ(result(), 5);
+    ASSERT_EQ(executor->get_counters().nodes_executed, 1);
+    ASSERT_EQ(executor->get_counters().defaults_copied, 1);
+    ASSERT_NE(
+        executor->explain_execution(node).find("default value changed"),
+        std::string::npos);
+
+    // Executing for another reason, the defaults are still in place.
+    executor->notify_node_dirty(node);
+    executor->reset_counters();
+    executor->execute(tree.get());
+    ASSERT_EQ(result(), 5);
+    ASSERT_EQ(executor->get_counters().nodes_executed, 1);
+    ASSERT_EQ(executor->get_counters().defaults_copied, 0);
+}
+
+TEST_F(NodeExecTest, DefaultsChangedInPlace)
+{
+    NodeTypeInfo increment_node("increment");
+    increment_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("value").default_val(5);
+        b.add_output<int>("result");
+    });
+    increment_node.set_execution_function([](ExeParams params) {
+        auto& value = params.get_input<int&>("value");
+        params.set_output("result", ++value);
+        return true;
+    });
+    increment_node.ALWAYS_REQUIRED = true;
+    tree->get_descriptor()->register_node(increment_node);
+
+    auto executor = create_node_tree_executor({});
+    auto node = tree->add_node("increment");
+
+    // Every execution starts from the default, not from the value the
+    // previous one left behind.
+    for (int i = 0; i < 3; ++i) {
+        executor->notify_node_dirty(node);
+        executor->execute(tree.get());
+        entt::meta_any result;
+        executor->sync_node_to_external_storage(
+            node->get_output_socket("result"), result);
+        ASSERT_EQ(result.cast<int>(), 6);
+    }
+    ASSERT_EQ(node->get_input_socket("value")->dataField.value.cast<int>(), 5);
+}
+
+TEST_F(NodeExecTest, RecordAndReplay)
+{
+    auto executor = create_node_tree_executor({});
+    auto recorder = std::make_shared<ExecutionRecorder>();
+    executor->set_recorder(recorder);
+
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    tree->add_link(
+        node0->get_output_socket("result"), node1->get_input_socket("a"));
+
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node0->get_input_socket("a"), 3);
+    executor->execute_tree(tree.get());
+
+    executor->prepare_tree(tree.get());
+    executor->sync_node_from_external_storage(node1->get_input_socket("b"), 7);
+    executor->execute_tree(tree.get());
+
+    // Unchanged, the tree is not stored again.
+    executor->execute(tree.get());
+
+    // An edited tree is stored again with the run that sees it.
+    auto node2 = tree->add_node("add");
+    tree->add_link(
+        node1->get_output_socket("result"), node2->get_input_socket("a"));
+    executor->execute(tree.get());
+
+    ASSERT_EQ(recorder->run_count(), 4);
+    auto recording = recorder->to_json();
+    auto& runs = recording["runs"];
+    ASSERT_EQ(runs[1]["inputs"].size(), 1);
+    // The synced input also became the socket's default.
+    ASSERT_TRUE(runs[0].contains("tree") && runs[1].contains("tree"));
+    ASSERT_FALSE(runs[2].contains("tree"));
+    ASSERT_TRUE(runs[3].contains("tree"));
+    // Only what a run executed is stored.
+    ASSERT_EQ(runs[1]["outputs"].size(), 1);
+    ASSERT_EQ(runs[2]["outputs"].size(), 0);
+
+    auto replay_executor = create_node_tree_executor({});
+    auto report = replay_execution(
+        recording, tree->get_descriptor(), replay_executor.get());
+    ASSERT_EQ(report.runs.size(), 4);
+    ASSERT_GT(report.runs[1].compared_outputs, 0);
+    ASSERT_GT(report.runs[3].compared_outputs, 0);
+    ASSERT_TRUE(report.outputs_match());
+
+    // A changed result is reported against its socket.
+    for (auto& output : recording["runs"][1]["outputs"]) {
+        if (output["socket"] == node1->get_output_socket("result")->ID.Get())
+            output["value"] = 0;
+    }
+    replay_executor = create_node_tree_executor({});
+    report = replay_execution(
+        recording, tree->get_descriptor(), replay_executor.get());
+    ASSERT_FALSE(report.outputs_match());
+    auto result_id =
+        static_cast<unsigned>(node1->get_output_socket("result")->ID.Get());
+    ASSERT_EQ(
+        report.runs[1].mismatched_sockets, std::vector<unsigned>{ result_id });
+}
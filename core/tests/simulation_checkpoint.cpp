@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <entt/meta/meta.hpp>
+
+#include "nodes/core/api.hpp"
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec_eager.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "nodes/core/simulation_checkpoint.hpp"
+#include "nodes/core/value_serializer.hpp"
+
+using namespace Ruzino;
+
+struct CounterStorage {
+    int count = 0;
+    std::vector<float> history;
+    static constexpr bool has_storage = false;
+};
+
+class SimulationCheckpointTest : public ::testing::Test {
+   protected:
+    void SetUp() override
+    {
+        register_cpp_type<int>();
+        register_cpp_type<CounterStorage>();
+        register_value_serializer<CounterStorage>(
+            [](const CounterStorage& storage, nlohmann::json& json) {
+                json["count"] = storage.count;
+                json["history"] = storage.history;
+            },
+            [](const nlohmann::json& json, CounterStorage& storage) {
+                storage.count = json["count"];
+                storage.history = json["history"].get<std::vector<float>>();
+            });
+
+        descriptor = std::make_shared<NodeTreeDescriptor>();
+
+        // Stands in for a simulation zone: advances its storage every run.
+        NodeTypeInfo simulation_in("simulation_in");
+        simulation_in.ALWAYS_REQUIRED = true;
+        simulation_in.ALWAYS_DIRTY = true;
+        simulation_in.set_declare_function([](NodeDeclarationBuilder& b) {
+            b.add_output<int>("count");
+        });
+        simulation_in.set_execution_function([](ExeParams params) {
+            auto& storage = params.get_storage<CounterStorage&>();
+            storage.count++;
+            storage.history.push_back(storage.count * 0.5f);
+            params.set_output("count", storage.count);
+            return true;
+        });
+        descriptor->register_node(simulation_in);
+
+        path = std::filesystem::temp_directory_path() /
+               ("checkpoint_test_" +
+                std::string(::testing::UnitTest::GetInstance()
+                                ->current_test_info()
+                                ->name()) +
+                ".rzckpt");
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(path);
+        entt::meta_reset();
+    }
+
+    std::shared_ptr<NodeTreeDescriptor> descriptor;
+    std::filesystem::path path;
+};
+
+TEST_F(SimulationCheckpointTest, ResumeFromFrame)
+{
+    auto tree = create_node_tree(descriptor);
+    auto node = tree->add_node("simulation_in");
+    auto executor = create_node_tree_executor({});
+
+    {
+        SimulationCheckpointFile checkpoint(path);
+        for (int frame = 0; frame < 5; ++frame) {
+            executor->execute(tree.get());
+            checkpoint.write_frame_async(
+                frame, capture_simulation_state(tree.get()));
+        }
+        checkpoint.flush();
+        ASSERT_EQ(checkpoint.frames().size(), 5);
+    }
+
+    // Resume from frame 2 in a freshly loaded tree.
+    auto loaded = create_node_tree(descriptor);
+    loaded->deserialize(tree->serialize());
+    auto loaded_executor = create_node_tree_executor({});
+
+    SimulationCheckpointFile checkpoint(path);
+    ASSERT_EQ(checkpoint.frames(), (std::vector<int64_t>{ 0, 1, 2, 3, 4 }));
+
+    nlohmann::json state;
+    ASSERT_TRUE(checkpoint.read_frame(2, state));
+    ASSERT_FALSE(checkpoint.read_frame(7, state));
+    ASSERT_TRUE(checkpoint.read_frame(2, state));
+    ASSERT_TRUE(restore_simulation_state(
+        loaded.get(), state, loaded_executor.get()));
+
+    auto loaded_node = loaded->find_node(node->ID);
+    ASSERT_EQ(loaded_node->storage.cast<CounterStorage&>().count, 3);
+    ASSERT_EQ(loaded_node->storage.cast<CounterStorage&>().history.size(), 3);
+
+    loaded_executor->execute(loaded.get());
+    entt::meta_any result;
+    loaded_executor->sync_node_to_external_storage(
+        loaded_node->get_output_socket("count"), result);
+    ASSERT_EQ(result.cast<int>(), 4);
+}
+
+TEST_F(SimulationCheckpointTest, TruncatedTailAndRewrite)
+{
+    {
+        SimulationCheckpointFile checkpoint(path);
+        for (int frame = 0; frame < 3; ++frame) {
+            ASSERT_TRUE(checkpoint.write_frame(frame, { { "frame", frame } }));
+        }
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 2);
+
+    nlohmann::json state;
+    {
+        SimulationCheckpointFile checkpoint(path);
+        ASSERT_EQ(checkpoint.frames(), (std::vector<int64_t>{ 0, 1 }));
+
+        // Rewriting a frame appends a chunk that shadows the old one.
+        checkpoint.write_frame_async(1, { { "frame", 10 } });
+        ASSERT_TRUE(checkpoint.read_frame(1, state));
+        ASSERT_EQ(state["frame"], 10);
+        ASSERT_TRUE(checkpoint.flush());
+        ASSERT_TRUE(checkpoint.read_frame(1, state));
+        ASSERT_EQ(state["frame"], 10);
+        ASSERT_TRUE(checkpoint.read_frame(0, state));
+        ASSERT_EQ(state["frame"], 0);
+    }
+
+    // The torn chunk was cut off, so the rewrite is found again
+    SimulationCheckpointFile checkpoint(path);
+    ASSERT_EQ(checkpoint.frames(), (std::vector<int64_t>{ 0, 1 }));
+    ASSERT_TRUE(checkpoint.read_frame(1, state));
+    ASSERT_EQ(state["frame"], 10);
+}
@@ -0,0 +1,98 @@
+#include "nodes/core/value_hash.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "nodes/core/math/vec.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+template<typename T>
+static void register_builtin_hasher(
+    std::unordered_map<entt::id_type, ValueHasher>& registry)
+{
+    registry[entt::type_hash<T>().value()] = [](const void* value) {
+        return std::hash<T>{}(*static_cast<const T*>(value));
+    };
+}
+
+template<typename T, size_t N>
+static void register_vec_hasher(
+    std::unordered_map<entt::id_type, ValueHasher>& registry)
+{
+    registry[entt::type_hash<Vec<T, N>>().value()] = [](const void* value) {
+        auto& vec = *static_cast<const Vec<T, N>*>(value);
+        size_t seed = 0;
+        for (auto component : vec.data) {
+            seed = hash_combine(seed, std::hash<T>{}(component));
+        }
+        return seed;
+    };
+}
+
+struct ValueHasherRegistry {
+    ValueHasherRegistry()
+    {
+        register_builtin_hasher<int>(hashers);
+        register_builtin_hasher<unsigned>(hashers);
+        register_builtin_hasher<int64_t>(hashers);
+        register_builtin_hasher<uint64_t>(hashers);
+        register_builtin_hasher<float>(hashers);
+        register_builtin_hasher<double>(hashers);
+        register_builtin_hasher<bool>(hashers);
+        register_builtin_hasher<std::string>(hashers);
+        register_vec_hasher<float, 2>(hashers);
+        register_vec_hasher<float, 3>(hashers);
+        register_vec_hasher<float, 4>(hashers);
+    }
+
+    std::shared_mutex mutex;
+    std::unordered_map<entt::id_type, ValueHasher> hashers;
+};
+
+static ValueHasherRegistry& value_hasher_registry()
+{
+    static ValueHasherRegistry registry;
+    return registry;
+}
+
+void register_value_hasher(entt::id_type type, ValueHasher hasher)
+{
+    auto& registry = value_hasher_registry();
+    std::unique_lock lock(registry.mutex);
+    registry.hashers[type] = std::move(hasher);
+}
+
+const ValueHasher* find_value_hasher(entt::id_type type)
+{
+    auto& registry = value_hasher_registry();
+    std::shared_lock lock(registry.mutex);
+    auto it = registry.hashers.find(type);
+    if (it == registry.hashers.end()) {
+        return nullptr;
+    }
+    // Entries are never erased, so the pointer stays valid.
+    return &it->second;
+}
+
+std::optional<size_t> hash_value(const entt::meta_any& value)
+{
+    if (!value) {
+        return std::nullopt;
+    }
+    auto hasher = find_value_hasher(value.type().id());
+    if (!hasher) {
+        return std::nullopt;
+    }
+    // Equal values of different types must not collide.
+    return hash_combine(value.type().id(), (*hasher)(value.data()));
+}
+
+size_t hash_combine(size_t seed, size_t value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
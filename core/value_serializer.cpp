@@ -0,0 +1,109 @@
+#include "nodes/core/value_serializer.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "nodes/core/math/vec.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+template<typename T, size_t N>
+static void register_vec_serializer(
+    std::unordered_map<entt::id_type, ValueSerializer>& registry)
+{
+    registry[entt::type_hash<Vec<T, N>>().value()] = ValueSerializer{
+        [](const entt::meta_any& value, nlohmann::json& json) {
+            json = value.cast<const Vec<T, N>&>().data;
+        },
+        [](const nlohmann::json& json, entt::meta_any& value) {
+            Vec<T, N> vec;
+            vec.data = json.get<std::array<T, N>>();
+            value = entt::meta_any{ get_entt_ctx(), vec };
+        }
+    };
+}
+
+template<typename T>
+static void register_builtin_serializer(
+    std::unordered_map<entt::id_type, ValueSerializer>& registry)
+{
+    registry[entt::type_hash<T>().value()] = ValueSerializer{
+        [](const entt::meta_any& value, nlohmann::json& json) {
+            json = value.cast<const T&>();
+        },
+        [](const nlohmann::json& json, entt::meta_any& value) {
+            value = entt::meta_any{ get_entt_ctx(), json.get<T>() };
+        }
+    };
+}
+
+struct ValueSerializerRegistry {
+    ValueSerializerRegistry()
+    {
+        register_builtin_serializer<int>(serializers);
+        register_builtin_serializer<float>(serializers);
+        register_builtin_serializer<double>(serializers);
+        register_builtin_serializer<bool>(serializers);
+        register_builtin_serializer<std::string>(serializers);
+        register_vec_serializer<float, 2>(serializers);
+        register_vec_serializer<float, 3>(serializers);
+        register_vec_serializer<float, 4>(serializers);
+    }
+
+    std::shared_mutex mutex;
+    std::unordered_map<entt::id_type, ValueSerializer> serializers;
+};
+
+static ValueSerializerRegistry& value_serializer_registry()
+{
+    static ValueSerializerRegistry registry;
+    return registry;
+}
+
+void register_value_serializer(entt::id_type type, ValueSerializer serializer)
+{
+    auto& registry = value_serializer_registry();
+    std::unique_lock lock(registry.mutex);
+    registry.serializers[type] = std::move(serializer);
+}
+
+const ValueSerializer* find_value_serializer(entt::id_type type)
+{
+    auto& registry = value_serializer_registry();
+    std::shared_lock lock(registry.mutex);
+    auto it = registry.serializers.find(type);
+    if (it == registry.serializers.end()) {
+        return nullptr;
+    }
+    // Entries are never erased, so the pointer stays valid.
+    return &it->second;
+}
+
+bool serialize_value(const entt::meta_any& value, nlohmann::json& json)
+{
+    if (!value) {
+        return false;
+    }
+    auto serializer = find_value_serializer(value.type().id());
+    if (!serializer) {
+        return false;
+    }
+    serializer->serialize(value, json);
+    return true;
+}
+
+bool deserialize_value(
+    entt::id_type type,
+    const nlohmann::json& json,
+    entt::meta_any& value)
+{
+    auto serializer = find_value_serializer(type);
+    if (!serializer) {
+        return false;
+    }
+    serializer->deserialize(json, value);
+    return true;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
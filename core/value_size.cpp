@@ -0,0 +1,151 @@
+#include "nodes/core/value_size.hpp"
+
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "nodes/core/node.hpp"
+#include "nodes/core/socket.hpp"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+struct ValueSizeRegistry {
+    ValueSizeRegistry()
+    {
+        estimators[entt::type_hash<std::string>().value()] =
+            [](const void* value) {
+                auto& string = *static_cast<const std::string*>(value);
+                // Short strings live inside the object.
+                std::string empty;
+                if (string.capacity() <= empty.capacity())
+                    return sizeof(std::string);
+                return sizeof(std::string) + string.capacity() + 1;
+            };
+    }
+
+    std::shared_mutex mutex;
+    std::unordered_map<entt::id_type, ValueSizeEstimator> estimators;
+};
+
+static ValueSizeRegistry& value_size_registry()
+{
+    static ValueSizeRegistry registry;
+    return registry;
+}
+
+void register_value_size_estimator(
+    entt::id_type type,
+    ValueSizeEstimator estimator)
+{
+    auto& registry = value_size_registry();
+    std::unique_lock lock(registry.mutex);
+    registry.estimators[type] = std::move(estimator);
+}
+
+const ValueSizeEstimator* find_value_size_estimator(entt::id_type type)
+{
+    auto& registry = value_size_registry();
+    std::shared_lock lock(registry.mutex);
+    auto it = registry.estimators.find(type);
+    if (it == registry.estimators.end()) {
+        return nullptr;
+    }
+    // Entries are never erased, so the pointer stays valid.
+    return &it->second;
+}
+
+size_t estimate_value_size(const entt::meta_any& value)
+{
+    if (!value) {
+        return 0;
+    }
+    if (auto estimator = find_value_size_estimator(value.type().id())) {
+        return (*estimator)(value.data());
+    }
+    return value.type().size_of();
+}
+
+void MemoryReport::add(
+    const entt::meta_any& value,
+    const char* category,
+    Node* node,
+    NodeSocket* socket)
+{
+    if (!value) {
+        return;
+    }
+    auto bytes = estimate_value_size(value);
+
+    total.add(bytes);
+    per_category[category].add(bytes);
+    per_type[std::string(value.type().info().name())].add(bytes);
+    if (node)
+        per_node[node].add(bytes);
+    if (socket)
+        per_socket[socket].add(bytes);
+}
+
+static void merge_usage(
+    MemoryReport::Usage& usage,
+    const MemoryReport::Usage& other)
+{
+    usage.bytes += other.bytes;
+    usage.values += other.values;
+}
+
+void MemoryReport::merge(const MemoryReport& other, Node* node)
+{
+    merge_usage(total, other.total);
+    for (auto& [category, usage] : other.per_category) {
+        merge_usage(per_category[category], usage);
+    }
+    for (auto& [type, usage] : other.per_type) {
+        merge_usage(per_type[type], usage);
+    }
+    if (node)
+        merge_usage(per_node[node], other.total);
+}
+
+static nlohmann::json usage_to_json(const MemoryReport::Usage& usage)
+{
+    return { { "bytes", usage.bytes }, { "values", usage.values } };
+}
+
+nlohmann::json MemoryReport::to_json() const
+{
+    nlohmann::json json;
+    json["total"] = usage_to_json(total);
+    for (auto& [category, usage] : per_category) {
+        json["categories"][category] = usage_to_json(usage);
+    }
+    for (auto& [type, usage] : per_type) {
+        json["types"][type] = usage_to_json(usage);
+    }
+
+    std::vector<std::pair<Node*, Usage>> nodes(
+        per_node.begin(), per_node.end());
+    std::sort(nodes.begin(), nodes.end(), [](auto& a, auto& b) {
+        return a.second.bytes > b.second.bytes;
+    });
+    json["nodes"] = nlohmann::json::array();
+    for (auto& [node, usage] : nodes) {
+        auto entry = usage_to_json(usage);
+        entry["id"] = node->ID.Get();
+        entry["type"] = node->typeinfo->id_name;
+        entry["name"] = node->ui_name;
+        json["nodes"].push_back(std::move(entry));
+    }
+
+    json["sockets"] = nlohmann::json::array();
+    for (auto& [socket, usage] : per_socket) {
+        auto entry = usage_to_json(usage);
+        entry["id"] = socket->ID.Get();
+        entry["node"] = socket->node->ID.Get();
+        entry["identifier"] = socket->identifier;
+        json["sockets"].push_back(std::move(entry));
+    }
+    return json;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,116 @@
+#include "nodes/core/worker_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+WorkerPool& WorkerPool::instance()
+{
+    static WorkerPool pool(
+        std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+WorkerPool::WorkerPool(size_t thread_count)
+{
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    task_added.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+size_t WorkerPool::thread_count() const
+{
+    return threads.size();
+}
+
+void WorkerPool::worker_loop()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_added.wait(
+                lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::parallel_for(
+    size_t count,
+    const std::function<void(size_t)>& body,
+    size_t max_threads)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Helpers taken up after the last index was handed out find nothing
+    // left, so they never touch `body` once this returned.
+    struct Job {
+        std::atomic<size_t> next = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t done = 0;
+        std::exception_ptr failure;
+    };
+    auto job = std::make_shared<Job>();
+    auto work = [job, count, &body]() {
+        for (size_t i = job->next++; i < count; i = job->next++) {
+            std::exception_ptr failure;
+            try {
+                body(i);
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+            std::lock_guard lock(job->mutex);
+            if (failure && !job->failure)
+                job->failure = failure;
+            if (++job->done == count)
+                job->finished.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(count - 1, threads.size());
+    if (max_threads)
+        helpers = std::min(helpers, max_threads - 1);
+    if (helpers) {
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < helpers; ++i) {
+                tasks.push_back(work);
+            }
+        }
+        task_added.notify_all();
+    }
+    work();
+
+    std::unique_lock lock(job->mutex);
+    job->finished.wait(lock, [&] { return job->done == count; });
+    if (job->failure) {
+        std::rethrow_exception(job->failure);
+    }
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
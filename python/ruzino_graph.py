@@ -367,6 +367,7 @@ class RuzinoGraph:
         """
         self._ensure_initialized()
 
+        batch = []
         for (node, socket_name), value in input_values.items():
             n = self._resolve_node(node)
             socket = n.get_input_socket(socket_name)
@@ -374,8 +375,8 @@ class RuzinoGraph:
                 raise ValueError(
                     f"Socket '{socket_name}' not found on node '{n.ui_name}'"
                 )
-            meta_value = core.to_meta_any(value)
-            self._executor.sync_node_from_external_storage(socket, meta_value)
+            batch.append((socket, core.to_meta_any(value)))
+        self._executor.sync_batch_from_external(batch)
 
         return self
 
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "entt/meta/meta.hpp"
+#include "nodes/core/api.hpp"
+#include "nodes/core/id.hpp"
+#include "nodes/system/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+class NodeTree;
+struct NodeTreeExecutor;
+
+/**
+ * class EditQueue
+ * Graph edits submitted from any thread and applied by the thread executing
+ * the tree, so editing never has to wait for a run to finish. Submitting
+ * never blocks: edits are pushed onto a lock-free list which the executing
+ * thread takes over as a whole.
+ *
+ * Structural edits are applied between runs. They drop a run paused by a
+ * more urgent one, which would otherwise resume on nodes that may be gone.
+ * Default value changes do not touch the structure of the running cone and
+ * are also applied between nodes, as long as no structural edit was
+ * submitted before them. Setting the same default twice only applies the
+ * last value, deleting a node twice only deletes it once.
+ *
+ * NodeSystem::execute() drains its queue, see NodeSystem::edits().
+ */
+class NODES_SYSTEM_API EditQueue {
+   public:
+    EditQueue() = default;
+    EditQueue(const EditQueue&) = delete;
+    EditQueue& operator=(const EditQueue&) = delete;
+    ~EditQueue();
+
+    // Any thread.
+    void add_link(SocketID from, SocketID to);
+    void delete_link(LinkId link);
+    void delete_node(NodeId node);
+    void set_default_value(SocketID socket, entt::meta_any value);
+    // Anything else, treated as structural.
+    void submit(std::function<void(NodeTree* tree)> edit);
+
+    // The executing thread only. Applies what is safe at this point and
+    // returns the number of edits applied.
+    size_t apply(
+        NodeTree* tree,
+        NodeTreeExecutor* executor,
+        bool between_runs = true);
+
+    // Edits dropped because a later one made them redundant.
+    size_t coalesced() const;
+
+   private:
+    struct Edit {
+        enum class Kind {
+            AddLink,
+            DeleteLink,
+            DeleteNode,
+            SetDefault,
+            Custom,
+        } kind;
+        SocketID from;
+        SocketID to;
+        LinkId link;
+        NodeId node;
+        entt::meta_any value;
+        std::function<void(NodeTree* tree)> custom;
+    };
+
+    struct Entry {
+        Edit edit;
+        Entry* next = nullptr;
+    };
+
+    void push(Edit edit);
+    void take_submitted();
+    void coalesce();
+    void apply_edit(Edit& edit, NodeTree* tree, NodeTreeExecutor* executor);
+
+    std::atomic<Entry*> submitted{ nullptr };
+    // Taken over by the executing thread, in submission order
+    std::vector<Edit> pending;
+    std::atomic<size_t> coalesced_count{ 0 };
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
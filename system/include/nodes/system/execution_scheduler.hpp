@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "nodes/core/api.hpp"
+#include "nodes/core/id.hpp"
+#include "nodes/core/result_snapshot.hpp"
+#include "nodes/system/api.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+class NodeTree;
+struct NodeTreeExecutor;
+struct Node;
+
+enum class ExecutionPriority {
+    // Full evaluations nobody is waiting on
+    Background,
+    // The UI asking for the value of a node
+    Interactive,
+};
+
+/**
+ * class ExecutionScheduler
+ * Execution requests of different priorities sharing one executor. A request
+ * of higher priority than the running one pauses it at the next node
+ * boundary, see NodeTreeExecutor::request_pause(); the paused run is resumed
+ * once nothing more urgent is left. Runs share the executor's results, so
+ * nodes one of them executed are not executed again by the other.
+ *
+ * Requests come from any thread and are served by whichever thread calls
+ * run(). A request while another thread serves is left to that thread.
+ * NodeSystem::execute() goes through the scheduler of its system.
+ */
+class NODES_SYSTEM_API ExecutionScheduler {
+   public:
+    // Any thread. A null node evaluates the whole tree. Requests for the
+    // same node, priority and quality not served yet are merged.
+    void request(
+        Node* required_node,
+        ExecutionPriority priority,
+        ExecutionQuality quality = ExecutionQuality::Final);
+    bool has_requests() const;
+
+    // Serves requests, the most urgent first, until none of at least
+    // `lowest` priority is left. Each run sets the quality of its request on
+    // the executor. Returns the number of runs completed, 0 right away when
+    // another thread is serving. `between_runs` is called before each run,
+    // e.g. to apply structural edits.
+    size_t run(
+        NodeTree* tree,
+        NodeTreeExecutor* executor,
+        const std::function<void()>& between_runs = {},
+        ExecutionPriority lowest = ExecutionPriority::Background);
+
+    // Runs paused for a more urgent one.
+    size_t preemptions() const;
+
+   private:
+    struct Request {
+        // Invalid for the whole tree
+        NodeId node;
+        ExecutionPriority priority = ExecutionPriority::Background;
+        ExecutionQuality quality = ExecutionQuality::Final;
+    };
+
+    mutable std::mutex mutex;
+    std::deque<Request> requests;
+    bool serving = false;
+    // Valid while serving
+    ExecutionPriority running_priority = ExecutionPriority::Background;
+    NodeTreeExecutor* running_executor = nullptr;
+    std::atomic<size_t> preemption_count{ 0 };
+};
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
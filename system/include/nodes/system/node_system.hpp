@@ -1,10 +1,16 @@
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "entt/meta/meta.hpp"
 #include "nodes/core/api.hpp"
 #include "nodes/core/node.hpp"
 #include "nodes/core/node_tree.hpp"
 #include "nodes/system/api.h"
+#include "nodes/system/edit_queue.hpp"
+#include "nodes/system/execution_scheduler.hpp"
 
 RUZINO_NAMESPACE_OPEN_SCOPE
 class NODES_SYSTEM_API NodeSystem {
@@ -23,6 +29,12 @@ class NODES_SYSTEM_API NodeSystem {
     // Type-erased version for Python bindings
     void set_global_params_any(const entt::meta_any& params);
 
+    // Requests a run, interactive for UI executions, and serves the requests
+    // unless another thread already does. That thread then runs it, pausing
+    // a background run if needed, and this returns right away. With
+    // progressive_execution, a UI execution serves a preview run only and
+    // the final one follows on a background thread of the system, paused by
+    // later UI executions. Structural edits must then go through edits().
     virtual void execute(
         bool is_ui_execution = false,
         Node* required_node = nullptr) const;
@@ -33,7 +45,24 @@ class NODES_SYSTEM_API NodeSystem {
     // Get list of loaded configuration files
     [[nodiscard]] const std::vector<std::string>& get_loaded_configs() const;
 
+    // Edits from other threads, applied by execute() between runs and, for
+    // default values, between nodes. Threads other than the executing one
+    // should only edit the tree through it.
+    [[nodiscard]] EditQueue& edits() const;
+    // Applies what was submitted so far, for hosts not calling execute().
+    size_t apply_pending_edits();
+
+    // Execution requests, see execute().
+    [[nodiscard]] ExecutionScheduler& scheduler() const;
+    // Serves the requests made so far, see ExecutionScheduler::run().
+    size_t run_scheduled(
+        ExecutionPriority lowest = ExecutionPriority::Background) const;
+    // Blocks until the background thread served the requests it was woken
+    // for, see execute().
+    void wait_for_background_runs() const;
+
     bool allow_ui_execution = true;
+    bool progressive_execution = false;
 
     virtual std::shared_ptr<NodeTreeDescriptor> node_tree_descriptor() = 0;
 
@@ -41,6 +70,22 @@ class NODES_SYSTEM_API NodeSystem {
     std::unique_ptr<NodeTree> node_tree;
     std::unique_ptr<NodeTreeExecutor> node_tree_executor;
     std::vector<std::string> loaded_config_files;  // Track loaded config files
+    mutable EditQueue edit_queue;
+    mutable ExecutionScheduler execution_scheduler;
+
+    // Joins the background thread. Systems owning the node types call it
+    // before releasing them.
+    void stop_background_runs();
+
+   private:
+    void background_loop() const;
+
+    mutable std::mutex background_mutex;
+    mutable std::condition_variable background_changed;
+    mutable std::thread background_thread;
+    mutable bool background_requested = false;
+    mutable bool background_running = false;
+    bool background_stopping = false;
 };
 
 template<typename T>
@@ -48,6 +93,7 @@ void NodeSystem::set_global_params(T global_params)
 {
     register_cpp_type<T>();
     node_tree_executor->get_global_payload<T&>() = global_params;
+    node_tree_executor->notify_global_payload_changed();
 }
 
 std::shared_ptr<NodeSystem> NODES_SYSTEM_API create_dynamic_loading_system();
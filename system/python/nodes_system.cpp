@@ -1,11 +1,14 @@
 #include <nanobind/nanobind.h>
 #include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
 
 #include "entt/meta/meta.hpp"
 #include "nodes/core/node.hpp"
 #include "nodes/core/node_exec_eager.hpp"
+#include "nodes/core/node_link.hpp"
 #include "nodes/core/node_tree.hpp"
+#include "nodes/core/value_size.hpp"
 #include "nodes/system/node_system.hpp"
 #include "nodes/system/node_system_dl.hpp"
 
@@ -17,6 +20,24 @@ NB_MODULE(nodes_system_py, m)
     // Import nodes_core_py for NodeTree and other base types
     nb::module_::import_("nodes_core_py");
 
+    nb::class_<ExecutorCounters>(m, "ExecutorCounters")
+        .def_ro("nodes_executed", &ExecutorCounters::nodes_executed)
+        .def_ro("nodes_failed", &ExecutorCounters::nodes_failed)
+        .def_ro("nodes_skipped", &ExecutorCounters::nodes_skipped)
+        .def_ro("frame_cache_hits", &ExecutorCounters::frame_cache_hits)
+        .def_ro("quality_cache_hits", &ExecutorCounters::quality_cache_hits)
+        .def_ro("pure_reuses", &ExecutorCounters::pure_reuses)
+        .def_ro("async_completions", &ExecutorCounters::async_completions)
+        .def_ro("foreach_iterations", &ExecutorCounters::foreach_iterations)
+        .def_ro("values_copied", &ExecutorCounters::values_copied)
+        .def_ro("defaults_copied", &ExecutorCounters::defaults_copied)
+        .def_ro("values_constructed", &ExecutorCounters::values_constructed)
+        .def_ro("dirty_marks", &ExecutorCounters::dirty_marks)
+        .def_ro("storage_lookups", &ExecutorCounters::storage_lookups)
+        .def_ro(
+            "persistent_cache_bytes",
+            &ExecutorCounters::persistent_cache_bytes);
+
     // NodeTreeExecutor
     nb::class_<NodeTreeExecutor>(m, "NodeTreeExecutor")
         .def(
@@ -38,6 +59,17 @@ NB_MODULE(nodes_system_py, m)
             &NodeTreeExecutor::execute_tree,
             nb::arg("tree"),
             "Execute the prepared tree")
+        .def(
+            "execute_tree_for",
+            &NodeTreeExecutor::execute_tree_for,
+            nb::arg("tree"),
+            nb::arg("budget_ms"),
+            "Execute the prepared tree for about budget_ms, True once the run "
+            "is complete; the next call resumes an incomplete run")
+        .def(
+            "has_unfinished_run",
+            &NodeTreeExecutor::has_unfinished_run,
+            "A time-sliced run is waiting to be resumed")
         .def(
             "sync_node_from_external_storage",
             &NodeTreeExecutor::sync_node_from_external_storage,
@@ -53,24 +85,31 @@ NB_MODULE(nodes_system_py, m)
         .def(
             "sync_batch_from_external",
             [](NodeTreeExecutor& exec, const nb::list& data) {
+                std::vector<std::pair<NodeSocket*, entt::meta_any>> inputs;
+                inputs.reserve(data.size());
                 for (size_t i = 0; i < data.size(); ++i) {
                     auto pair = nb::cast<nb::tuple>(data[i]);
-                    auto* socket = nb::cast<NodeSocket*>(pair[0]);
-                    auto value = nb::cast<entt::meta_any>(pair[1]);
-                    exec.sync_node_from_external_storage(socket, value);
+                    inputs.emplace_back(
+                        nb::cast<NodeSocket*>(pair[0]),
+                        nb::cast<entt::meta_any>(pair[1]));
                 }
+                exec.sync_batch_from_external_storage(inputs);
             },
             nb::arg("data"),
             "Batch set socket values: [(socket, meta_any), ...]")
         .def(
             "sync_batch_to_external",
             [](NodeTreeExecutor& exec, const nb::list& sockets) {
-                nb::list results;
+                std::vector<NodeSocket*> targets;
+                targets.reserve(sockets.size());
                 for (size_t i = 0; i < sockets.size(); ++i) {
-                    auto* socket = nb::cast<NodeSocket*>(sockets[i]);
-                    entt::meta_any data;
-                    exec.sync_node_to_external_storage(socket, data);
-                    results.append(data);
+                    targets.push_back(nb::cast<NodeSocket*>(sockets[i]));
+                }
+                // Python gets its own copies, made straight from the
+                // executor's values.
+                nb::list results;
+                for (auto* value : exec.borrow_socket_values(targets)) {
+                    results.append(value ? *value : entt::meta_any{});
                 }
                 return results;
             },
@@ -86,6 +125,96 @@ NB_MODULE(nodes_system_py, m)
             &NodeTreeExecutor::notify_socket_dirty,
             nb::arg("socket"),
             "Notify executor that a socket has been modified")
+        .def(
+            "notify_global_payload_changed",
+            &NodeTreeExecutor::notify_global_payload_changed,
+            nb::arg("fields") = std::vector<std::string>{},
+            "Dirty the nodes reading the given global payload fields, all "
+            "payload readers when empty")
+        .def(
+            "enable_frame_cache",
+            &NodeTreeExecutor::enable_frame_cache,
+            nb::arg("frame_budget_bytes"),
+            nb::arg("max_frames") = 0,
+            "Cache time-dependent outputs per frame, within a per-frame "
+            "memory budget")
+        .def(
+            "disable_frame_cache",
+            &NodeTreeExecutor::disable_frame_cache,
+            "Disable and drop the frame cache")
+        .def(
+            "set_frame",
+            &NodeTreeExecutor::set_frame,
+            nb::arg("frame"),
+            "Select the frame cache slot for the next execution")
+        .def(
+            "subscribe_result",
+            [](NodeTreeExecutor& exec, NodeSocket* socket) {
+                exec.results().subscribe(socket);
+            },
+            nb::arg("socket"),
+            "Publish the socket's value after every run")
+        .def(
+            "unsubscribe_result",
+            [](NodeTreeExecutor& exec, NodeSocket* socket) {
+                exec.results().unsubscribe(socket);
+            },
+            nb::arg("socket"),
+            "Stop publishing the socket's value")
+        .def(
+            "published_epoch",
+            [](NodeTreeExecutor& exec) { return exec.results().epoch(); },
+            "Run count of the latest published results, 0 for none")
+        .def(
+            "get_published_value",
+            [](NodeTreeExecutor& exec, NodeSocket* socket) {
+                auto snapshot = exec.results().latest();
+                auto value = snapshot ? snapshot->find(socket) : nullptr;
+                return value ? *value : entt::meta_any{};
+            },
+            nb::arg("socket"),
+            "Value of a subscribed socket in the latest published results, "
+            "safe to call while another thread executes")
+        .def(
+            "get_counters",
+            &NodeTreeExecutor::get_counters,
+            "Operation counts accumulated since the last reset_counters()")
+        .def(
+            "reset_counters",
+            &NodeTreeExecutor::reset_counters,
+            "Reset the operation counters")
+        .def(
+            "memory_report",
+            [](const NodeTreeExecutor& exec) {
+                return exec.memory_report().to_json().dump();
+            },
+            "Estimated bytes retained per category, type, node and socket, "
+            "as a JSON string")
+        .def(
+            "explain_execution",
+            &NodeTreeExecutor::explain_execution,
+            nb::arg("node"),
+            "Explain why the node executed in the last run")
+        .def(
+            "set_quality",
+            &NodeTreeExecutor::set_quality,
+            nb::arg("quality"),
+            "Quality of the next runs, results are kept per quality")
+        .def(
+            "get_quality",
+            &NodeTreeExecutor::get_quality,
+            "Quality of the next runs")
+        .def(
+            "fork",
+            &NodeTreeExecutor::fork,
+            "A new executor holding this one's results, for evaluating a "
+            "variant of the tree; defaults synced into it stay in it")
+        .def(
+            "commit_fork",
+            &NodeTreeExecutor::commit_fork,
+            nb::arg("fork"),
+            "Write the defaults changed in the fork to the tree and take over "
+            "its results")
         .def(
             "reset_allocator",
             &NodeTreeExecutor::reset_allocator,
@@ -93,6 +222,14 @@ NB_MODULE(nodes_system_py, m)
             "rendering)");
 
     // Base NodeSystem class
+    nb::enum_<ExecutionPriority>(m, "ExecutionPriority")
+        .value("Background", ExecutionPriority::Background)
+        .value("Interactive", ExecutionPriority::Interactive);
+
+    nb::enum_<ExecutionQuality>(m, "ExecutionQuality")
+        .value("Preview", ExecutionQuality::Preview)
+        .value("Final", ExecutionQuality::Final);
+
     nb::class_<NodeSystem>(m, "NodeSystem")
         .def(
             "init",
@@ -134,7 +271,71 @@ NB_MODULE(nodes_system_py, m)
             "allow_ui_execution",
             &NodeSystem::allow_ui_execution,
             "Flag to allow execution triggered by UI interactions")
+        .def_rw(
+            "progressive_execution",
+            &NodeSystem::progressive_execution,
+            "UI executions run a preview and leave the final run to "
+            "run_scheduled")
         .def("finalize", &NodeSystem::finalize, "Finalize the node system")
+        .def(
+            "queue_add_link",
+            [](NodeSystem& self, NodeSocket* from, NodeSocket* to) {
+                self.edits().add_link(from->ID, to->ID);
+            },
+            nb::arg("from_socket"),
+            nb::arg("to_socket"),
+            "Add a link at the next safe point, callable from any thread")
+        .def(
+            "queue_delete_link",
+            [](NodeSystem& self, NodeLink* link) {
+                self.edits().delete_link(link->ID);
+            },
+            nb::arg("link"),
+            "Delete a link at the next safe point, callable from any thread")
+        .def(
+            "queue_delete_node",
+            [](NodeSystem& self, Node* node) {
+                self.edits().delete_node(node->ID);
+            },
+            nb::arg("node"),
+            "Delete a node at the next safe point, callable from any thread")
+        .def(
+            "queue_set_default_value",
+            [](NodeSystem& self, NodeSocket* socket, entt::meta_any value) {
+                self.edits().set_default_value(socket->ID, std::move(value));
+            },
+            nb::arg("socket"),
+            nb::arg("value"),
+            "Set a socket default at the next safe point, callable from any "
+            "thread")
+        .def(
+            "request_execution",
+            [](NodeSystem& self,
+               Node* required_node,
+               ExecutionPriority priority,
+               ExecutionQuality quality) {
+                self.scheduler().request(required_node, priority, quality);
+            },
+            nb::arg("required_node") = nullptr,
+            nb::arg("priority") = ExecutionPriority::Background,
+            nb::arg("quality") = ExecutionQuality::Final,
+            "Request a run, callable from any thread")
+        .def(
+            "run_scheduled",
+            &NodeSystem::run_scheduled,
+            nb::arg("lowest") = ExecutionPriority::Background,
+            "Serve the requested runs of at least the given priority, the "
+            "most urgent first")
+        .def_prop_ro(
+            "preemptions",
+            [](const NodeSystem& self) {
+                return self.scheduler().preemptions();
+            },
+            "Runs paused for a more urgent one")
+        .def(
+            "apply_pending_edits",
+            &NodeSystem::apply_pending_edits,
+            "Apply the queued edits now")
         .def(
             "set_global_params",
             &NodeSystem::set_global_params_any,
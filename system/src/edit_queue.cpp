@@ -0,0 +1,210 @@
+#include "nodes/system/edit_queue.hpp"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec.hpp"
+#include "nodes/core/node_link.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "spdlog/spdlog.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+EditQueue::~EditQueue()
+{
+    auto entry = submitted.exchange(nullptr);
+    while (entry) {
+        delete std::exchange(entry, entry->next);
+    }
+}
+
+void EditQueue::push(Edit edit)
+{
+    auto entry = new Entry{ std::move(edit) };
+    entry->next = submitted.load(std::memory_order_relaxed);
+    while (!submitted.compare_exchange_weak(
+        entry->next,
+        entry,
+        std::memory_order_release,
+        std::memory_order_relaxed)) {
+    }
+}
+
+void EditQueue::add_link(SocketID from, SocketID to)
+{
+    Edit edit{ Edit::Kind::AddLink };
+    edit.from = from;
+    edit.to = to;
+    push(std::move(edit));
+}
+
+void EditQueue::delete_link(LinkId link)
+{
+    Edit edit{ Edit::Kind::DeleteLink };
+    edit.link = link;
+    push(std::move(edit));
+}
+
+void EditQueue::delete_node(NodeId node)
+{
+    Edit edit{ Edit::Kind::DeleteNode };
+    edit.node = node;
+    push(std::move(edit));
+}
+
+void EditQueue::set_default_value(SocketID socket, entt::meta_any value)
+{
+    Edit edit{ Edit::Kind::SetDefault };
+    edit.to = socket;
+    edit.value = std::move(value);
+    push(std::move(edit));
+}
+
+void EditQueue::submit(std::function<void(NodeTree* tree)> edit)
+{
+    Edit custom{ Edit::Kind::Custom };
+    custom.custom = std::move(edit);
+    push(std::move(custom));
+}
+
+void EditQueue::take_submitted()
+{
+    auto entry = submitted.exchange(nullptr, std::memory_order_acquire);
+    if (!entry) {
+        return;
+    }
+
+    // The list is newest first
+    auto first = pending.size();
+    while (entry) {
+        pending.push_back(std::move(entry->edit));
+        delete std::exchange(entry, entry->next);
+    }
+    std::reverse(pending.begin() + first, pending.end());
+    coalesce();
+}
+
+void EditQueue::coalesce()
+{
+    std::set<uintptr_t> defaults_set;
+    std::set<uintptr_t> nodes_deleted;
+    std::vector<bool> redundant(pending.size());
+
+    // The last value of a default wins
+    for (auto i = pending.size(); i-- > 0;) {
+        auto& edit = pending[i];
+        if (edit.kind == Edit::Kind::SetDefault)
+            redundant[i] = !defaults_set.insert(edit.to.Get()).second;
+    }
+    // The first delete of a node does it
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto& edit = pending[i];
+        if (edit.kind == Edit::Kind::DeleteNode)
+            redundant[i] = !nodes_deleted.insert(edit.node.Get()).second;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (redundant[i]) {
+            coalesced_count++;
+            continue;
+        }
+        if (kept != i)
+            pending[kept] = std::move(pending[i]);
+        kept++;
+    }
+    pending.erase(pending.begin() + kept, pending.end());
+}
+
+void EditQueue::apply_edit(
+    Edit& edit,
+    NodeTree* tree,
+    NodeTreeExecutor* executor)
+{
+    switch (edit.kind) {
+        case Edit::Kind::AddLink: {
+            auto from = tree->find_pin(edit.from);
+            auto to = tree->find_pin(edit.to);
+            if (!from || !to) {
+                spdlog::warn(
+                    "Queued link from socket {} to {} dropped, a socket is "
+                    "gone",
+                    edit.from.Get(),
+                    edit.to.Get());
+                return;
+            }
+            tree->add_link(from, to);
+            if (executor) {
+                executor->notify_node_dirty(to->node);
+            }
+        } break;
+        case Edit::Kind::DeleteLink: {
+            auto link = tree->find_link(edit.link);
+            if (!link) {
+                return;
+            }
+            Node* affected = link->to_sock ? link->to_sock->node : nullptr;
+            tree->delete_link(edit.link);
+            if (executor && affected) {
+                executor->notify_node_dirty(affected);
+            }
+        } break;
+        case Edit::Kind::DeleteNode:
+            tree->delete_node(edit.node, true);
+            // The executor may still hold the node and its sockets
+            if (executor) {
+                executor->mark_tree_structure_changed();
+            }
+            break;
+        case Edit::Kind::SetDefault: {
+            auto socket = tree->find_pin(edit.to);
+            if (!socket) {
+                return;
+            }
+            // The executor sees the new version, no need to notify it
+            socket->dataField.value = std::move(edit.value);
+            socket->mark_default_changed();
+        } break;
+        case Edit::Kind::Custom: edit.custom(tree); break;
+    }
+}
+
+size_t EditQueue::apply(
+    NodeTree* tree,
+    NodeTreeExecutor* executor,
+    bool between_runs)
+{
+    take_submitted();
+
+    // Between nodes, only the defaults before the first structural edit
+    size_t count = 0;
+    bool paused_run_dropped = false;
+    while (count < pending.size() &&
+           (between_runs || pending[count].kind == Edit::Kind::SetDefault)) {
+        // A run paused by a more urgent one would resume on the edited
+        // structure, so it starts over instead
+        if (pending[count].kind != Edit::Kind::SetDefault && executor &&
+            !paused_run_dropped && executor->has_unfinished_run()) {
+            executor->mark_tree_structure_changed();
+            paused_run_dropped = true;
+        }
+        try {
+            apply_edit(pending[count], tree, executor);
+        }
+        catch (const std::exception& e) {
+            spdlog::error("Queued edit failed: {}", e.what());
+        }
+        count++;
+    }
+    pending.erase(pending.begin(), pending.begin() + count);
+    return count;
+}
+
+size_t EditQueue::coalesced() const
+{
+    return coalesced_count;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
@@ -0,0 +1,116 @@
+#include "nodes/system/execution_scheduler.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "nodes/core/node.hpp"
+#include "nodes/core/node_exec.hpp"
+#include "nodes/core/node_tree.hpp"
+#include "spdlog/spdlog.h"
+
+RUZINO_NAMESPACE_OPEN_SCOPE
+
+void ExecutionScheduler::request(
+    Node* required_node,
+    ExecutionPriority priority,
+    ExecutionQuality quality)
+{
+    NodeId node = required_node ? required_node->ID : NodeId{};
+
+    std::lock_guard lock(mutex);
+    auto queued =
+        std::find_if(requests.begin(), requests.end(), [&](const Request& r) {
+            return r.node == node && r.priority == priority &&
+                   r.quality == quality;
+        });
+    if (queued == requests.end()) {
+        requests.push_back({ node, priority, quality });
+    }
+    if (serving && running_executor && priority > running_priority) {
+        running_executor->request_pause();
+    }
+}
+
+bool ExecutionScheduler::has_requests() const
+{
+    std::lock_guard lock(mutex);
+    return !requests.empty();
+}
+
+size_t ExecutionScheduler::run(
+    NodeTree* tree,
+    NodeTreeExecutor* executor,
+    const std::function<void()>& between_runs,
+    ExecutionPriority lowest)
+{
+    {
+        std::lock_guard lock(mutex);
+        if (serving) {
+            return 0;
+        }
+        serving = true;
+    }
+
+    size_t completed = 0;
+    while (true) {
+        Request request;
+        {
+            std::lock_guard lock(mutex);
+            // The first of the most urgent ones
+            auto next = std::max_element(
+                requests.begin(),
+                requests.end(),
+                [](const Request& lhs, const Request& rhs) {
+                    return lhs.priority < rhs.priority;
+                });
+            if (next == requests.end() || next->priority < lowest) {
+                serving = false;
+                running_executor = nullptr;
+                return completed;
+            }
+            request = *next;
+            requests.erase(next);
+            running_priority = request.priority;
+            running_executor = executor;
+            // Asked for the run served before
+            executor->clear_pause_request();
+        }
+
+        if (between_runs) {
+            between_runs();
+        }
+
+        Node* required_node = nullptr;
+        if (request.node) {
+            required_node = tree->find_node(request.node);
+            if (!required_node) {
+                spdlog::warn(
+                    "Execution request for node {} dropped, the node is gone",
+                    request.node.Get());
+                continue;
+            }
+        }
+
+        // Restarts a paused run, its clean nodes are not executed again
+        executor->set_quality(request.quality);
+        executor->prepare_tree(tree, required_node);
+        bool finished = executor->execute_tree_for(
+            tree, std::numeric_limits<double>::infinity());
+        if (finished) {
+            completed++;
+            continue;
+        }
+
+        // Paused, it goes on after the more urgent requests
+        std::lock_guard lock(mutex);
+        preemption_count++;
+        requests.push_front(request);
+    }
+}
+
+size_t ExecutionScheduler::preemptions() const
+{
+    return preemption_count;
+}
+
+RUZINO_NAMESPACE_CLOSE_SCOPE
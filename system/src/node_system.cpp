@@ -27,10 +27,12 @@ void NodeSystem::set_node_tree_executor(
 
 NodeSystem::~NodeSystem()
 {
+    stop_background_runs();
 }
 
 void NodeSystem::finalize()
 {
+    stop_background_runs();
     if (node_tree_executor) {
         node_tree_executor->finalize(node_tree.get());
     }
@@ -41,9 +43,112 @@ void NodeSystem::execute(bool is_ui_execution, Node* required_node) const
     if (is_ui_execution && !allow_ui_execution) {
         return;
     }
-    if (node_tree_executor) {
-        return node_tree_executor->execute(node_tree.get(), required_node);
+    if (!node_tree_executor) {
+        return;
+    }
+    if (is_ui_execution && progressive_execution) {
+        execution_scheduler.request(
+            required_node,
+            ExecutionPriority::Interactive,
+            ExecutionQuality::Preview);
+        execution_scheduler.request(
+            required_node,
+            ExecutionPriority::Background,
+            ExecutionQuality::Final);
+        run_scheduled(ExecutionPriority::Interactive);
+        {
+            std::lock_guard lock(background_mutex);
+            if (background_stopping)
+                return;
+            if (!background_thread.joinable())
+                background_thread =
+                    std::thread(&NodeSystem::background_loop, this);
+            background_requested = true;
+        }
+        background_changed.notify_all();
+        return;
+    }
+    execution_scheduler.request(
+        required_node,
+        is_ui_execution ? ExecutionPriority::Interactive
+                        : ExecutionPriority::Background);
+    run_scheduled();
+}
+
+size_t NodeSystem::run_scheduled(ExecutionPriority lowest) const
+{
+    if (!node_tree_executor) {
+        return 0;
+    }
+    auto executor = node_tree_executor.get();
+    auto tree = node_tree.get();
+    auto between_runs = [this, tree, executor]() {
+        edit_queue.apply(tree, executor);
+        executor->set_safe_point([this, tree, executor]() {
+            edit_queue.apply(tree, executor, false);
+        });
+    };
+    return execution_scheduler.run(tree, executor, between_runs, lowest);
+}
+
+void NodeSystem::background_loop() const
+{
+    std::unique_lock lock(background_mutex);
+    while (true) {
+        background_changed.wait(lock, [this] {
+            return background_stopping || background_requested;
+        });
+        if (background_stopping)
+            break;
+        background_requested = false;
+        background_running = true;
+        lock.unlock();
+
+        // Returns right away when another thread serves, which then runs
+        // the background requests too
+        run_scheduled();
+
+        lock.lock();
+        background_running = false;
+        background_changed.notify_all();
+    }
+}
+
+void NodeSystem::wait_for_background_runs() const
+{
+    std::unique_lock lock(background_mutex);
+    background_changed.wait(lock, [this] {
+        return background_stopping ||
+               (!background_requested && !background_running);
+    });
+}
+
+void NodeSystem::stop_background_runs()
+{
+    {
+        std::lock_guard lock(background_mutex);
+        background_stopping = true;
     }
+    background_changed.notify_all();
+    if (background_thread.joinable())
+        background_thread.join();
+    std::lock_guard lock(background_mutex);
+    background_stopping = false;
+}
+
+ExecutionScheduler& NodeSystem::scheduler() const
+{
+    return execution_scheduler;
+}
+
+EditQueue& NodeSystem::edits() const
+{
+    return edit_queue;
+}
+
+size_t NodeSystem::apply_pending_edits()
+{
+    return edit_queue.apply(node_tree.get(), node_tree_executor.get());
 }
 
 NodeTree* NodeSystem::get_node_tree() const
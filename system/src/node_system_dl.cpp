@@ -5,6 +5,7 @@
 #include <fstream>
 #include <iostream>
 #include <nodes/core/io/json.hpp>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #ifdef _WIN32
@@ -64,6 +65,8 @@ NodeDynamicLoadingSystem::NodeDynamicLoadingSystem()
 
 NodeDynamicLoadingSystem::~NodeDynamicLoadingSystem()
 {
+    // Background runs execute node types of the libraries
+    stop_background_runs();
     descriptor = {};
     this->node_tree.reset();
     this->node_tree_executor.reset();
@@ -151,6 +154,22 @@ bool NodeDynamicLoadingSystem::load_configuration(
                     library_map[key]->template getFunction<bool()>(
                         "node_always_dirty_" + func_name_str);
 
+                auto node_pure =
+                    library_map[key]->template getFunction<bool()>(
+                        "node_pure_" + func_name_str);
+
+                auto node_thread_safe =
+                    library_map[key]->template getFunction<bool()>(
+                        "node_thread_safe_" + func_name_str);
+
+                auto node_cost =
+                    library_map[key]->template getFunction<float()>(
+                        "node_cost_" + func_name_str);
+
+                auto node_inplace =
+                    library_map[key]->template getFunction<const char*()>(
+                        "node_inplace_" + func_name_str);
+
                 auto node_declare =
                     library_map[key]
                         ->template getFunction<void(NodeDeclarationBuilder&)>(
@@ -193,6 +212,19 @@ bool NodeDynamicLoadingSystem::load_configuration(
                     spdlog::info("{} is always dirty.", func_name_str.c_str());
                 }
 
+                new_node.PURE = node_pure ? node_pure() : false;
+                new_node.THREAD_SAFE =
+                    node_thread_safe ? node_thread_safe() : false;
+                new_node.COST = node_cost ? node_cost() : 0.0f;
+                if (node_inplace) {
+                    std::stringstream inputs(node_inplace());
+                    std::string input;
+                    while (std::getline(inputs, input, ',')) {
+                        if (!input.empty())
+                            new_node.inplace_inputs.push_back(input);
+                    }
+                }
+
                 new_node.set_declare_function(node_declare);
                 new_node.set_execution_function(node_execution);
 
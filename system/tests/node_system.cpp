@@ -2,6 +2,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+
 #include "spdlog/spdlog.h"
 
 using namespace Ruzino;
@@ -90,3 +93,233 @@ TEST(NodeSystem, DynamicSockets)
     // Restore log level
     spdlog::set_level(spdlog::level::info);
 }
+
+class AddNodeSystem : public NodeSystem {
+   public:
+    bool load_configuration(const std::string& config) override
+    {
+        return true;
+    }
+
+   private:
+    std::shared_ptr<NodeTreeDescriptor> node_tree_descriptor() override
+    {
+        register_cpp_type<int>();
+        auto descriptor = std::make_shared<NodeTreeDescriptor>();
+        NodeTypeInfo add_node("add");
+        add_node.ALWAYS_REQUIRED = true;
+        add_node.set_declare_function([](NodeDeclarationBuilder& b) {
+            b.add_input<int>("a");
+            b.add_input<int>("b").default_val(1);
+            b.add_output<int>("result");
+        });
+        add_node.set_execution_function([](ExeParams params) {
+            params.set_output(
+                "result",
+                params.get_input<int>("a") + params.get_input<int>("b"));
+            return true;
+        });
+        descriptor->register_node(add_node);
+        return descriptor;
+    }
+};
+
+TEST(NodeSystem, EditQueue)
+{
+    AddNodeSystem system;
+    system.init();
+    auto tree = system.get_node_tree();
+    auto node0 = tree->add_node("add");
+    auto node1 = tree->add_node("add");
+    auto b0 = node0->get_input_socket("b")->ID;
+    auto result1 = node1->get_output_socket("result");
+
+    // Several editors at once, each setting the same default repeatedly
+    std::vector<std::thread> editors;
+    for (int t = 0; t < 4; ++t) {
+        editors.emplace_back([&system, b0]() {
+            for (int i = 0; i < 100; ++i) {
+                system.edits().set_default_value(b0, entt::meta_any{ 3 });
+            }
+        });
+    }
+    for (auto& editor : editors) {
+        editor.join();
+    }
+    system.edits().add_link(
+        node0->get_output_socket("result")->ID,
+        node1->get_input_socket("a")->ID);
+    system.edits().delete_node(tree->add_node("add")->ID);
+    ASSERT_EQ(tree->nodes.size(), 3);
+    ASSERT_EQ(tree->links.size(), 0);
+
+    system.execute();
+    ASSERT_EQ(tree->nodes.size(), 2);
+    ASSERT_EQ(tree->links.size(), 1);
+    ASSERT_EQ(system.edits().coalesced(), 399);
+
+    entt::meta_any value;
+    system.get_node_tree_executor()->sync_node_to_external_storage(
+        result1, value);
+    ASSERT_EQ(value.cast<int>(), 4);  // (0+3)+1
+
+    // node1 loses its input with the node feeding it
+    system.edits().delete_node(node0->ID);
+    system.execute();
+    system.get_node_tree_executor()->sync_node_to_external_storage(
+        result1, value);
+    ASSERT_EQ(value.cast<int>(), 1);
+}
+
+TEST(NodeSystem, ExecutionPriorities)
+{
+    AddNodeSystem system;
+    system.init();
+    auto tree = system.get_node_tree();
+
+    std::vector<int> order;
+    Node* interactive = nullptr;
+    NodeTypeInfo record_node("record");
+    record_node.ALWAYS_REQUIRED = true;
+    record_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("in");
+        b.add_input<int>("tag");
+        b.add_output<int>("result");
+    });
+    record_node.set_execution_function([&](ExeParams params) {
+        auto tag = params.get_input<int>("tag");
+        order.push_back(tag);
+        // The UI asks for a node meanwhile. Only one thread serves, the
+        // request is left to the running one.
+        if (tag == 1) {
+            system.execute(true, interactive);
+        }
+        params.set_output("result", params.get_input<int>("in") + tag);
+        return true;
+    });
+    tree->get_descriptor()->register_node(record_node);
+
+    Node* nodes[3];
+    for (int i = 0; i < 3; ++i) {
+        nodes[i] = tree->add_node("record");
+        nodes[i]->get_input_socket("tag")->set_default_value(i + 1);
+    }
+    tree->add_link(
+        nodes[0]->get_output_socket("result"),
+        nodes[1]->get_input_socket("in"));
+    tree->add_link(
+        nodes[0]->get_output_socket("result"),
+        nodes[2]->get_input_socket("in"));
+    interactive = nodes[2];
+
+    // The full evaluation pauses after the first node, the interactive cone
+    // reuses it and the evaluation resumes without running it again
+    system.execute();
+    ASSERT_EQ(order, (std::vector<int>{ 1, 3, 2 }));
+    ASSERT_EQ(system.scheduler().preemptions(), 1);
+    ASSERT_FALSE(system.scheduler().has_requests());
+
+    entt::meta_any value;
+    system.get_node_tree_executor()->sync_node_to_external_storage(
+        nodes[1]->get_output_socket("result"), value);
+    ASSERT_EQ(value.cast<int>(), 3);
+}
+
+TEST(NodeSystem, EditsDuringPreemptedRun)
+{
+    AddNodeSystem system;
+    system.init();
+    auto tree = system.get_node_tree();
+
+    std::vector<int> order;
+    Node* nodes[3];
+    bool preempted = false;
+    NodeTypeInfo record_node("record");
+    record_node.ALWAYS_REQUIRED = true;
+    record_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("in");
+        b.add_input<int>("tag");
+        b.add_output<int>("result");
+    });
+    record_node.set_execution_function([&](ExeParams params) {
+        auto tag = params.get_input<int>("tag");
+        order.push_back(tag);
+        // The node the background run goes on with is deleted while it is
+        // paused
+        if (tag == 1 && !preempted) {
+            preempted = true;
+            system.edits().delete_node(nodes[1]->ID);
+            system.execute(true, nodes[2]);
+        }
+        params.set_output("result", params.get_input<int>("in") + tag);
+        return true;
+    });
+    tree->get_descriptor()->register_node(record_node);
+
+    for (int i = 0; i < 3; ++i) {
+        nodes[i] = tree->add_node("record");
+        nodes[i]->get_input_socket("tag")->set_default_value(i + 1);
+    }
+    tree->add_link(
+        nodes[0]->get_output_socket("result"),
+        nodes[1]->get_input_socket("in"));
+    tree->add_link(
+        nodes[0]->get_output_socket("result"),
+        nodes[2]->get_input_socket("in"));
+
+    system.execute();
+    ASSERT_EQ(system.scheduler().preemptions(), 1);
+    ASSERT_EQ(tree->nodes.size(), 2);
+    ASSERT_EQ(std::count(order.begin(), order.end(), 2), 0);
+    ASSERT_EQ(std::count(order.begin(), order.end(), 3), 1);
+
+    entt::meta_any value;
+    system.get_node_tree_executor()->sync_node_to_external_storage(
+        nodes[2]->get_output_socket("result"), value);
+    ASSERT_EQ(value.cast<int>(), 4);
+}
+
+TEST(NodeSystem, ProgressiveExecution)
+{
+    AddNodeSystem system;
+    system.init();
+    system.progressive_execution = true;
+    auto tree = system.get_node_tree();
+
+    NodeTypeInfo render_node("render");
+    render_node.ALWAYS_REQUIRED = true;
+    render_node.set_declare_function([](NodeDeclarationBuilder& b) {
+        b.add_input<int>("in");
+        b.add_output<int>("result");
+    });
+    // Runs on the UI thread, then on the background one
+    std::vector<ExecutionQuality> qualities;
+    render_node.set_execution_function([&qualities](ExeParams params) {
+        qualities.push_back(params.get_quality());
+        auto samples =
+            params.get_quality() == ExecutionQuality::Preview ? 1 : 64;
+        params.set_output("result", params.get_input<int>("in") * samples);
+        return true;
+    });
+    tree->get_descriptor()->register_node(render_node);
+
+    auto add = tree->add_node("add");
+    auto render = tree->add_node("render");
+    tree->add_link(
+        add->get_output_socket("result"), render->get_input_socket("in"));
+    auto executor = system.get_node_tree_executor();
+    auto rendered = render->get_output_socket("result");
+    executor->results().subscribe(rendered);
+
+    // The UI gets the preview, the final run follows without the host
+    system.execute(true);
+    system.wait_for_background_runs();
+    ASSERT_EQ(
+        qualities,
+        (std::vector<ExecutionQuality>{ ExecutionQuality::Preview,
+                                        ExecutionQuality::Final }));
+    auto published = executor->results().latest();
+    ASSERT_EQ(published->quality, ExecutionQuality::Final);
+    ASSERT_EQ(published->find(rendered)->cast<int>(), 64);
+    ASSERT_FALSE(system.scheduler().has_requests());
+}
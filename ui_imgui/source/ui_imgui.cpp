@@ -627,6 +627,9 @@ bool NodeWidget::draw_socket_controllers(NodeSocket* input)
             break;
         }
     }
+    // The widgets write in place
+    if (changed)
+        input->mark_default_changed();
     return changed;
 }
 